@@ -382,7 +382,7 @@ public:
 	/// \param count count of bytes to copy from array
 	/// \return count of bytes put in this buffer, or 0 if memory block is to large
 	inline std::size_t put(const uint8_t* arr, std::size_t count) noexcept {
-		if( io_likely( 0 != count || nullptr != arr || count <= available() ) ) {
+		if( io_likely( 0 != count && nullptr != arr && count <= available() ) ) {
 			io_memmove( position_, arr, count);
 			position_ += count;
 			last_ = position_ + 1;
@@ -0,0 +1,182 @@
+/*
+ *
+ * Copyright (c) 2016-2019
+ * Viktor Gubin
+ *
+ * Use, modification and distribution are subject to the
+ * Boost Software License, Version 1.0. (See accompanying file
+ * LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+#ifndef __IO_BUFFERED_CHANNEL_HPP_INCLUDED__
+#define __IO_BUFFERED_CHANNEL_HPP_INCLUDED__
+
+#include "config.hpp"
+
+#ifdef HAS_PRAGMA_ONCE
+#pragma once
+#endif // HAS_PRAGMA_ONCE
+
+#include "channels.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace io {
+
+/// \brief Buffering read channel decorator
+/// Reads underlying channel by large blocks into internal buffer, so that small reads
+/// are served from memory. Buffer content can be scanned in place using view_read_channel interface
+class IO_PUBLIC_SYMBOL buffered_read_channel final: public view_read_channel
+{
+private:
+	friend class nobadalloc<buffered_read_channel>;
+	buffered_read_channel(const s_read_channel& src, scoped_arr<uint8_t>&& buff) noexcept;
+public:
+	/// Opens buffered read channel
+	/// \param ec operation error code, contains error when out of memory
+	/// \param src source channel to decorate, must not be empty
+	/// \param buffer_size internal buffer size in bytes, 0 to use operating system page size
+	/// \return buffered channel smart reference, or empty reference in case of error
+	/// \throw never throws
+	static s_view_read_channel open(std::error_code& ec, const s_read_channel& src, std::size_t buffer_size) noexcept;
+
+	/// Opens buffered read channel with operating system page size buffer
+	/// \param ec operation error code, contains error when out of memory
+	/// \param src source channel to decorate, must not be empty
+	/// \return buffered channel smart reference, or empty reference in case of error
+	/// \throw never throws
+	static inline s_view_read_channel open(std::error_code& ec, const s_read_channel& src) noexcept {
+		return open(ec, src, 0);
+	}
+
+	virtual ~buffered_read_channel() noexcept override;
+	//! @copydoc read_channel::read(std::error_code,uint8_t*,std::size_t)
+	virtual std::size_t read(std::error_code& ec,uint8_t* const buff, std::size_t bytes) const noexcept override;
+	//! @copydoc view_read_channel::fill(std::error_code&)
+	virtual read_view fill(std::error_code& ec) const noexcept override;
+	//! @copydoc view_read_channel::consume(std::size_t)
+	virtual void consume(std::size_t bytes) const noexcept override;
+private:
+	s_read_channel src_;
+	scoped_arr<uint8_t> buff_;
+	mutable std::size_t pos_;
+	mutable std::size_t end_;
+};
+
+/// \brief Read ahead channel decorator, overlaps input with processing of the data
+/// A background thread reads underlying channel into a ring of blocks while consumer scans previous blocks in place,
+/// i.e. double buffering for the default two blocks. Filled blocks are handed off between threads by a lock free
+/// single producer single consumer queue, threads are sleeping only when the ring is empty or full.
+/// Channel itself should be used from a single thread, underlying channel is used only from the background thread
+class IO_PUBLIC_SYMBOL read_ahead_channel final: public view_read_channel
+{
+private:
+	friend class nobadalloc<read_ahead_channel>;
+	read_ahead_channel(const s_read_channel& src, scoped_arr<uint8_t>&& buff, scoped_arr<std::size_t>&& sizes, std::size_t block_size) noexcept;
+	bool start(std::error_code& ec) noexcept;
+	void run() noexcept;
+	void wait_filled(std::size_t block) const noexcept;
+	bool wait_released(std::size_t block) noexcept;
+public:
+
+	/// Default size of a block
+	static constexpr std::size_t DEFAULT_BLOCK_SIZE = 0x10000; // 64k
+
+	/// Default count of blocks
+	static constexpr std::size_t DEFAULT_BLOCKS = 2;
+
+	/// Opens read ahead channel, and starts reading underlying channel on a background thread
+	/// \param ec operation error code, contains error when out of memory or thread can not be started
+	/// \param src source channel to decorate, must not be empty
+	/// \param block_size size of a block in bytes, 0 for the default block size
+	/// \param blocks count of blocks in the ring, 0 or 1 for the default count of blocks
+	/// \return read ahead channel smart reference, or empty reference in case of error
+	/// \throw never throws
+	static s_view_read_channel open(std::error_code& ec, const s_read_channel& src, std::size_t block_size, std::size_t blocks) noexcept;
+
+	/// Opens double buffering read ahead channel with the default blocks size
+	/// \param ec operation error code, contains error when out of memory or thread can not be started
+	/// \param src source channel to decorate, must not be empty
+	/// \return read ahead channel smart reference, or empty reference in case of error
+	/// \throw never throws
+	static inline s_view_read_channel open(std::error_code& ec, const s_read_channel& src) noexcept {
+		return open(ec, src, 0, 0);
+	}
+
+	/// Stops background thread, waits until it finishes current read from the underlying channel
+	virtual ~read_ahead_channel() noexcept override;
+	//! @copydoc read_channel::read(std::error_code,uint8_t*,std::size_t)
+	virtual std::size_t read(std::error_code& ec,uint8_t* const buff, std::size_t bytes) const noexcept override;
+	//! @copydoc view_read_channel::fill(std::error_code&)
+	virtual read_view fill(std::error_code& ec) const noexcept override;
+	//! @copydoc view_read_channel::consume(std::size_t)
+	virtual void consume(std::size_t bytes) const noexcept override;
+private:
+	s_read_channel src_;
+	scoped_arr<uint8_t> buff_;
+	// sizes of data in blocks, 0 marks the end of data
+	scoped_arr<std::size_t> sizes_;
+	std::size_t block_size_;
+	// count of blocks filled by the background thread
+	std::atomic_size_t filled_;
+	// count of blocks released by consumer, current block is the next one
+	mutable std::atomic_size_t released_;
+	// consumed bytes of the current block
+	mutable std::size_t pos_;
+	// background thread read error, published with the end of data block
+	std::error_code ec_;
+	std::atomic_bool stop_;
+	mutable std::atomic_bool consumer_waits_;
+	std::atomic_bool producer_waits_;
+	mutable std::mutex mtx_;
+	mutable std::condition_variable cv_;
+	std::thread worker_;
+};
+
+/// \brief Buffering write channel decorator
+/// Collects small writes in internal buffer and passes them into underlying channel by large blocks.
+/// Buffered data is written on buffer overflow, #flush call or channel destruction
+class IO_PUBLIC_SYMBOL buffered_write_channel final: public write_channel
+{
+private:
+	friend class nobadalloc<buffered_write_channel>;
+	buffered_write_channel(const s_write_channel& dst, scoped_arr<uint8_t>&& buff) noexcept;
+	void drain(std::error_code& ec) const noexcept;
+public:
+	/// Opens buffered write channel
+	/// \param ec operation error code, contains error when out of memory
+	/// \param dst destination channel to decorate, must not be empty
+	/// \param buffer_size internal buffer size in bytes, 0 to use operating system page size
+	/// \return buffered channel smart reference, or empty reference in case of error
+	/// \throw never throws
+	static s_write_channel open(std::error_code& ec, const s_write_channel& dst, std::size_t buffer_size) noexcept;
+
+	/// Opens buffered write channel with operating system page size buffer
+	/// \param ec operation error code, contains error when out of memory
+	/// \param dst destination channel to decorate, must not be empty
+	/// \return buffered channel smart reference, or empty reference in case of error
+	/// \throw never throws
+	static inline s_write_channel open(std::error_code& ec, const s_write_channel& dst) noexcept {
+		return open(ec, dst, 0);
+	}
+
+	/// Writes all buffered data into destination channel
+	virtual ~buffered_write_channel() noexcept override;
+	//! @copydoc write_channel::write(std::error_code,const uint8_t*,std::size_t)
+	virtual std::size_t write(std::error_code& ec, const uint8_t* buff,std::size_t size) const noexcept override;
+	/// Writes all buffered data into destination channel and flushes destination channel
+	/// \param ec operation error code
+	/// \throw never throws
+	virtual void flush(std::error_code& ec) const noexcept override;
+private:
+	s_write_channel dst_;
+	scoped_arr<uint8_t> buff_;
+	mutable std::size_t pos_;
+};
+
+} // namespace io
+
+#endif // __IO_BUFFERED_CHANNEL_HPP_INCLUDED__
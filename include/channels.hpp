@@ -38,12 +38,33 @@ protected:
 		object()
 	{}
 	virtual ~channel() override = default;
+public:
+	/// Returns operating system descriptor of the underlying resource i.e. file or socket,
+	/// allows transferring data between channels inside the kernel
+	/// \return descriptor, or -1 when channel is not backed by an operating system descriptor
+	virtual intptr_t native_handle() const noexcept {
+		return -1;
+	}
 };
 
 template <class C>
 class unsafe {
 };
 
+/// \brief A continues memory region to read data into, element of scatter read request
+/// \details Binary compatible with POSIX iovec structure
+struct read_segment {
+	uint8_t* data;
+	std::size_t size;
+};
+
+/// \brief A continues memory region to write data from, element of gather write request
+/// \details Binary compatible with POSIX iovec structure
+struct write_segment {
+	const uint8_t* data;
+	std::size_t size;
+};
+
 /**
   General interface to input operations on an resource like a: file, socket, std in device, named pipe, shared memory blocks etc.
  **/
@@ -61,10 +82,79 @@ public:
 	/// \return number of bytes read or 0 if nothing read or EOF riched
 	/// \throw never throws
 	virtual std::size_t read(std::error_code& ec,uint8_t* const buff, std::size_t bytes) const noexcept = 0;
+	/// Scatter read, reads data from underlying resource into several memory segments
+	/// filling them in order, default implementation reads each segment in turn
+	/// \param ec
+	///		operation error code
+	/// \param segments
+	///		array of memory segments to store read data, must not be nullptr
+	/// \param count
+	///		count of segments in array
+	/// \return total number of bytes read or 0 if nothing read or EOF riched
+	/// \throw never throws
+	virtual std::size_t readv(std::error_code& ec, const read_segment* segments, std::size_t count) const noexcept;
 };
 
 DECLARE_IPTR(read_channel);
 
+/// \brief Read only view on a contiguous memory region owned by a channel
+class read_view {
+public:
+	constexpr read_view() noexcept:
+		begin_(nullptr),
+		end_(nullptr)
+	{}
+	constexpr read_view(const uint8_t* begin, const uint8_t* end) noexcept:
+		begin_(begin),
+		end_(end)
+	{}
+	/// Returns address of the first byte in this view
+	inline const uint8_t* begin() const noexcept {
+		return begin_;
+	}
+	/// Returns address after the last byte in this view
+	inline const uint8_t* end() const noexcept {
+		return end_;
+	}
+	/// Returns view size in bytes
+	inline std::size_t size() const noexcept {
+		return memory_traits::distance(begin_, end_);
+	}
+	/// Checks whether this view contains no bytes
+	inline bool empty() const noexcept {
+		return begin_ == end_;
+	}
+private:
+	const uint8_t* begin_;
+	const uint8_t* end_;
+};
+
+/**
+ * General interface to input operations on a resource which can expose it's data
+ * as a contiguous read only memory region, like memory mapped files or memory buffers.
+ * Allows consumers to scan data in place without copying it into own buffers
+ **/
+class IO_PUBLIC_SYMBOL view_read_channel:public read_channel {
+protected:
+	view_read_channel() noexcept;
+public:
+	/// Returns a view on unread bytes, fetches next portion of data from underlying resource
+	/// when all bytes of the previews view were consumed
+	/// View stays valid until next fill call
+	/// \param ec
+	///		operation error code
+	/// \return view on unread bytes, empty view if EOF riched
+	/// \throw never throws
+	virtual read_view fill(std::error_code& ec) const noexcept = 0;
+	/// Marks bytes from the beginning of the current view as read
+	/// \param bytes
+	///		count of bytes to consume, must not be larger then current view size
+	/// \throw never throws
+	virtual void consume(std::size_t bytes) const noexcept = 0;
+};
+
+DECLARE_IPTR(view_read_channel);
+
 template <>
 class unsafe<read_channel> {
 public:
@@ -105,6 +195,25 @@ public:
 	/// \return number of bytes written or 0 if nothing written
 	/// \throw never throws
 	virtual std::size_t write(std::error_code& ec, const uint8_t* buff,std::size_t size) const noexcept = 0;
+	/// Gather write, writes data from several memory segments in order to underlying resource.
+	/// Default implementation joins small segments into a temporary buffer and writes it at once,
+	/// larger requests are written segment by segment
+	/// \param ec
+	///		operation error code
+	/// \param segments
+	///		array of memory segments to write, must not be nullptr
+	/// \param count
+	///		count of segments in array
+	/// \return total number of bytes written or 0 if nothing written
+	/// \throw never throws
+	virtual std::size_t writev(std::error_code& ec, const write_segment* segments, std::size_t count) const noexcept;
+	/// Forces all data written into this channel to reach the underlying storage device.
+	/// Allows writer to issue many writes and pay for a single synchronization at chosen points,
+	/// default implementation does nothing
+	/// \param ec
+	///		operation error code
+	/// \throw never throws
+	virtual void flush(std::error_code& ec) const noexcept;
 };
 
 DECLARE_IPTR(write_channel);
@@ -342,7 +451,24 @@ std::size_t IO_PUBLIC_SYMBOL transmit_buffer(
     std::size_t size) noexcept;
 
 
+/// Transmits several memory segments data into a write channel using gather write,
+/// function will re-attempt to write unless all segments will be written
+/// to the destination channel, or an io_error
+/// \param ec operation error code, contains error when io error
+/// \param dst destination write channel
+/// \param segments array of memory segments to transmit, must not be nullptr
+/// \param count count of segments in array, must be greater then 0
+/// \return count of bytes transfered
+/// \throw never throws
+std::size_t IO_PUBLIC_SYMBOL transmit_buffers(
+    std::error_code& ec,
+    const s_write_channel& dst,
+    const write_segment* segments,
+    std::size_t count) noexcept;
+
 /// Transmits all read channels data to destination write channel
+/// When both channels are backed by operating system descriptors, data transferred
+/// inside the kernel without copying into user space when it is possible
 /// \param ec operation error code, contains error
 ///				when io error or not enough memory for allocating buffer
 /// \param src source read channel
@@ -157,6 +157,36 @@ inline const char* mbtochar32(char32_t& dst, const char* src) noexcept
 	return nullptr;
 }
 
+/// Converts full UNICODE UTF-32 character value to UTF-8 single/multibyte character
+/// \param dst destination buffer, must have at least 4 bytes available
+/// \param ch UNICODE code point
+/// \return position after written UTF-8 character or nullptr when ch is not a valid UNICODE code point
+inline char* char32tomb(char* dst, const char32_t ch) noexcept
+{
+	const uint32_t c = static_cast<uint32_t>(ch);
+	if( c < 0x80 ) {
+		*dst++ = static_cast<char>(c);
+	} else if( c < 0x800 ) {
+		*dst++ = static_cast<char>( 0xC0 | (c >> 6) );
+		*dst++ = static_cast<char>( 0x80 | (c & 0x3F) );
+	} else if( c < 0x10000 ) {
+		// UTF-16 surrogates are not characters
+		if( io_unlikely( c >= 0xD800 && c <= 0xDFFF ) )
+			return nullptr;
+		*dst++ = static_cast<char>( 0xE0 | (c >> 12) );
+		*dst++ = static_cast<char>( 0x80 | ( (c >> 6) & 0x3F ) );
+		*dst++ = static_cast<char>( 0x80 | (c & 0x3F) );
+	} else if( c < 0x110000 ) {
+		*dst++ = static_cast<char>( 0xF0 | (c >> 18) );
+		*dst++ = static_cast<char>( 0x80 | ( (c >> 12) & 0x3F ) );
+		*dst++ = static_cast<char>( 0x80 | ( (c >> 6) & 0x3F ) );
+		*dst++ = static_cast<char>( 0x80 | (c & 0x3F) );
+	} else {
+		return nullptr;
+	}
+	return dst;
+}
+
 
 /// Returns UTF-8 string length in logical UNICODE characters
 /// \param u8str source UTF-8 string
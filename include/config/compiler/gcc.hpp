@@ -137,6 +137,12 @@
 #	endif // __LP64__
 #endif // clz
 
+// count trailing zero bits, i.e. index of the first set bit. Result is undefined for 0
+#define io_ctz(__x) __builtin_ctz((__x))
+
+// count of set bits
+#define io_popcount(__x) __builtin_popcount((__x))
+
 
 #define io_bswap32(__x) __builtin_bswap32((__x))
 #define io_bswap64(__x) __builtin_bswap64((__x))
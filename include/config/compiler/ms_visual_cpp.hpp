@@ -192,6 +192,17 @@
 #	endif 
 #endif
 
+// count trailing zero bits, i.e. index of the first set bit. Result is undefined for 0
+#pragma intrinsic(_BitScanForward)
+__forceinline int io_ctz(unsigned long x) noexcept {
+	unsigned long ret = 0;
+	_BitScanForward(&ret, x);
+	return static_cast<int>(ret);
+}
+
+// count of set bits
+#define io_popcount(__x) __popcnt((__x))
+
 
 namespace io {
 namespace detail {
@@ -23,7 +23,8 @@
 namespace io {
 
 /// \brief Memory buffer read channel
-class IO_PUBLIC_SYMBOL memory_read_channel final: public read_channel
+/// Buffer content can be scanned in place using view_read_channel interface
+class IO_PUBLIC_SYMBOL memory_read_channel final: public view_read_channel
 {
 private:
 	friend class nobadalloc<memory_read_channel>;
@@ -37,6 +38,10 @@ public:
 	virtual ~memory_read_channel() noexcept;
 	//! @copydoc read_channel::read(std::error_code,uint8_t*,std::size_t)
 	virtual std::size_t read(std::error_code& ec,uint8_t* const buff, std::size_t bytes) const noexcept override;
+	//! @copydoc view_read_channel::fill(std::error_code&)
+	virtual read_view fill(std::error_code& ec) const noexcept override;
+	//! @copydoc view_read_channel::consume(std::size_t)
+	virtual void consume(std::size_t bytes) const noexcept override;
 private:
 	mutable byte_buffer data_;
 	mutable critical_section mtx_;
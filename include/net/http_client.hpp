@@ -32,10 +32,10 @@ class header {
             name_( std::forward<const_string>(name) ),
             value_( std::forward<const_string>(value) )
         {}
-		const_string name() const noexcept {
+		const const_string& name() const noexcept {
 			return name_;
 		}
-		const_string value() const noexcept {
+		const const_string& value() const noexcept {
 			return value_;
 		}
    private:
@@ -0,0 +1,176 @@
+/*
+ *
+ * Copyright (c) 2016-2019
+ * Viktor Gubin
+ *
+ * Use, modification and distribution are subject to the
+ * Boost Software License, Version 1.0. (See accompanying file
+ * LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+#ifndef __IO_POSIX_ASYNCH_CHANNEL_HPP_INCLUDED__
+#define __IO_POSIX_ASYNCH_CHANNEL_HPP_INCLUDED__
+
+#include <config.hpp>
+
+#ifdef HAS_PRAGMA_ONCE
+#pragma once
+#endif // HAS_PRAGMA_ONCE
+
+#include <channels.hpp>
+
+#include "files.hpp"
+
+// Linux kernel io_uring ABI structures, defined in <linux/io_uring.h>
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace io {
+
+namespace posix {
+class asynch_channel;
+} // namespace posix
+
+/// \brief Linux io_uring based asynchronous input/output completion service
+/// Read and write requests of asynchronous channels are queued into the kernel submission ring,
+/// and submitted in batches on #submit or #run_once call. Completions are dispatched to the
+/// channels callbacks from the thread calling #run_once or #run.
+/// Reads are performed directly into the buffer passed to the read completion callback.
+/// Service is not thread safe, channels operations and completion loop must run on the same thread
+class IO_PUBLIC_SYMBOL asynch_io_service final:public object {
+	asynch_io_service(const asynch_io_service&) = delete;
+	asynch_io_service& operator=(const asynch_io_service&) = delete;
+private:
+	friend class nobadalloc<asynch_io_service>;
+	friend class posix::asynch_channel;
+	struct operation;
+	explicit asynch_io_service(unsigned int queue_depth) noexcept;
+	bool start(std::error_code& ec) noexcept;
+public:
+
+	/// Default count of operations can be in flight at the same time
+	static constexpr unsigned int DEFAULT_QUEUE_DEPTH = 64;
+
+	/// Creates new asynchronous input/output service
+	/// \param ec operation error code, contains error when kernel does not support io_uring
+	///				or out of memory
+	/// \param queue_depth maximal count of operations in flight, rounded by kernel to the power of 2
+	/// \return intrusive pointer on service, or empty pointer in case of error
+	/// \throw never throws
+	static boost::intrusive_ptr<asynch_io_service> create(std::error_code& ec, unsigned int queue_depth) noexcept;
+
+	/// Creates new asynchronous input/output service with the default queue depth
+	/// \param ec operation error code
+	/// \throw never throws
+	static inline boost::intrusive_ptr<asynch_io_service> create(std::error_code& ec) noexcept {
+		return create(ec, DEFAULT_QUEUE_DEPTH);
+	}
+
+	virtual ~asynch_io_service() noexcept override;
+
+	/// Constructs asynchronous channel over an opened file or socket descriptor,
+	/// channel takes descriptor ownership
+	/// \param ec operation error code
+	/// \param fd opened file or socket descriptor
+	/// \param rc read completion callback
+	/// \param wc write completion callback
+	/// \throw never throws
+	s_asynch_read_write_channel client_asynch_channel(std::error_code& ec, posix::fd_t fd, const asynch_callback& rc, const asynch_callback& wc) noexcept;
+
+	/// Opens a file for asynchronous reading and writing
+	/// \param ec operation error code, contains error when file can not be opened
+	/// \param f file to open
+	/// \param mode writing mode \see write_open_mode
+	/// \param rc read completion callback
+	/// \param wc write completion callback
+	/// \throw never throws
+	s_asynch_read_write_channel file_asynch_channel(std::error_code& ec, const file& f, write_open_mode mode, const asynch_callback& rc, const asynch_callback& wc) noexcept;
+
+	/// Submits all queued requests to the kernel in a single system call
+	/// \param ec operation error code
+	/// \return count of submitted requests
+	/// \throw never throws
+	std::size_t submit(std::error_code& ec) noexcept;
+
+	/// Submits queued requests and dispatches all available completions
+	/// \param ec operation error code
+	/// \param wait whether to block until at least one operation completes when any is in flight
+	/// \return count of dispatched completions
+	/// \throw never throws, unless callbacks throws
+	std::size_t run_once(std::error_code& ec, bool wait);
+
+	/// Runs completion loop until no operations left in flight
+	/// \param ec operation error code
+	/// \throw never throws, unless callbacks throws
+	void run(std::error_code& ec);
+
+	/// Returns count of operations queued or in flight
+	inline std::size_t pending() const noexcept {
+		return in_flight_;
+	}
+
+private:
+	void read(const posix::asynch_channel* ch, std::size_t bytes, std::size_t pos) noexcept;
+	void write(const posix::asynch_channel* ch, byte_buffer&& buff, std::size_t pos) noexcept;
+	bool cancel(const posix::asynch_channel* ch, bool writes) noexcept;
+	::io_uring_sqe* next_sqe() noexcept;
+	void push_sqe() noexcept;
+	operation* new_operation(const posix::asynch_channel* ch, std::size_t pos) noexcept;
+	void release_operation(operation* op) noexcept;
+	void queue_write(operation* op) noexcept;
+	void complete(operation* op, int res);
+
+private:
+	unsigned int queue_depth_;
+	int ring_fd_;
+	// submission queue ring
+	uint8_t* sq_ring_;
+	std::size_t sq_ring_size_;
+	unsigned int* sq_head_;
+	unsigned int* sq_tail_;
+	unsigned int* sq_mask_;
+	unsigned int* sq_array_;
+	unsigned int sq_entries_;
+	::io_uring_sqe* sqes_;
+	// completion queue ring
+	uint8_t* cq_ring_;
+	std::size_t cq_ring_size_;
+	unsigned int* cq_head_;
+	unsigned int* cq_tail_;
+	unsigned int* cq_mask_;
+	::io_uring_cqe* cqes_;
+	// operations pool
+	operation* ops_;
+	operation* free_ops_;
+	unsigned int to_submit_;
+	std::size_t in_flight_;
+};
+
+DECLARE_IPTR(asynch_io_service);
+
+namespace posix {
+
+/// \brief io_uring asynchronous channel over a file or socket descriptor
+class IO_PUBLIC_SYMBOL asynch_channel final:public asynch_read_write_channel {
+public:
+	asynch_channel(fd_t fd, asynch_io_service* service, const asynch_callback& rc, const asynch_callback& wc) noexcept;
+	virtual ~asynch_channel() noexcept override;
+	virtual void read(std::size_t bytes, std::size_t pos) const noexcept override;
+	virtual void write(byte_buffer&& buff, std::size_t pos) const noexcept override;
+	/// Cancels reads in flight i.e. waiting for socket data, queued writes are kept
+	virtual bool cancel_pending() const noexcept override;
+	/// Cancels all reads and writes in flight
+	virtual bool cancel_all() const noexcept override;
+private:
+	friend class io::asynch_io_service;
+	fd_t fd_;
+	// whether requests carries file offset, or uses current position for pipes and sockets
+	bool seekable_;
+	s_asynch_io_service service_;
+};
+
+} // namespace posix
+
+} // namespace io
+
+#endif // __IO_POSIX_ASYNCH_CHANNEL_HPP_INCLUDED__
@@ -18,8 +18,12 @@
 #endif // HAS_PRAGMA_ONCE
 
 #include <cerrno>
+#include <cstddef>
+#include <climits>
 #include <string>
 
+#include <sys/uio.h>
+
 #include <text.hpp>
 
 #ifdef __LP64__
@@ -60,6 +64,12 @@ public:
 
 	virtual std::size_t write(std::error_code& ec, const uint8_t* buff,std::size_t size) const noexcept override;
 
+	virtual void flush(std::error_code& ec) const noexcept override;
+
+	virtual std::size_t readv(std::error_code& ec, const read_segment* segments, std::size_t count) const noexcept override;
+
+	virtual std::size_t writev(std::error_code& ec, const write_segment* segments, std::size_t count) const noexcept override;
+
 	virtual std::size_t forward(std::error_code& ec,std::size_t size) noexcept override;
 
 	virtual std::size_t backward(std::error_code& ec, std::size_t size) noexcept override;
@@ -69,12 +79,71 @@ public:
 	virtual std::size_t from_end(std::error_code& ec, std::size_t size) noexcept override;
 
 	virtual std::size_t position(std::error_code& ec) noexcept override;
+
+	virtual intptr_t native_handle() const noexcept override {
+		return fd_;
+	}
 private:
 	inline std::size_t seek(std::error_code& ec,int64_t offset, int whence) noexcept;
 private:
 	fd_t fd_;
 };
 
+/// \brief Memory mapped file read channel
+/// Maps whole file or a sliding window of the file into process address space,
+/// so that file content can be scanned in place without copying it into user-space buffers
+class IO_PUBLIC_SYMBOL mapped_file_channel final:public view_read_channel
+{
+public:
+	mapped_file_channel(fd_t fd, std::size_t file_size, std::size_t window, int advice) noexcept;
+
+	virtual ~mapped_file_channel() noexcept override;
+
+	virtual std::size_t read(std::error_code& ec,uint8_t* const buff, std::size_t bytes) const noexcept override;
+
+	virtual read_view fill(std::error_code& ec) const noexcept override;
+
+	virtual void consume(std::size_t bytes) const noexcept override;
+private:
+	bool map_next(std::error_code& ec) const noexcept;
+	void unmap() const noexcept;
+private:
+	fd_t fd_;
+	std::size_t file_size_;
+	std::size_t window_;
+	int advice_;
+	// offset of the currently mapped window from the file begin
+	mutable std::size_t offset_;
+	mutable uint8_t* map_;
+	mutable std::size_t map_size_;
+	mutable std::size_t pos_;
+};
+
+
+/// Converts scatter/gather segments array into POSIX iovec array
+/// \param segments segments array
+/// \return iovec array of the same segments
+template<typename S>
+static inline const ::iovec* to_iovec(const S* segments) noexcept {
+	static_assert( sizeof(S) == sizeof(::iovec) && offsetof(S, data) == offsetof(::iovec, iov_base) && offsetof(S, size) == offsetof(::iovec, iov_len), "Segment is not binary compatible with iovec" );
+	return reinterpret_cast<const ::iovec*>(segments);
+}
+
+/// Limits segments count to the maximal count of segments system accepts in a single call
+static inline int iov_count(std::size_t count) noexcept {
+	return count > IOV_MAX ? IOV_MAX : static_cast<int>(count);
+}
+
+/// Transfers data between two descriptors inside the kernel using
+/// copy_file_range, sendfile or splice depending on descriptors kind
+/// \param ec operation error code
+/// \param src source descriptor
+/// \param dst destination descriptor
+/// \param transfered count of transferred bytes
+/// \return false when kernel can not transfer data between this descriptors,
+///			so that user space copying should be used instead
+/// \throw never throws
+bool kernel_transmit(std::error_code& ec, fd_t src, fd_t dst, std::size_t& transfered) noexcept;
 
 } // namespace posix
 
@@ -89,6 +158,29 @@ enum class write_open_mode
 	overwrite
 };
 
+/// \brief file writing durability policy
+enum class write_durability
+{
+	/// Writes are cached by operating system, data reaches storage device
+	/// on write_channel::flush call or on operating system discretion
+	none,
+	/// Each write waits until data reaches storage device, but not metadata like modification time (O_DSYNC)
+	data_sync,
+	/// Each write waits until data and file metadata reaches storage device (O_SYNC)
+	full_sync
+};
+
+
+/// \brief memory mapped file access pattern hints
+enum class access_pattern
+{
+	/// No special treatment
+	normal,
+	/// Pages will be accessed in sequential order, mapped pages read-ahead aggressively
+	sequential,
+	/// Pages will be accessed in random order, no read-ahead
+	random
+};
 
 /// \brief File system file operations interface, POSIX implementation
 class IO_PUBLIC_SYMBOL file
@@ -157,14 +249,48 @@ public:
 	/// \throw never throws
 	s_read_channel open_for_read(std::error_code& ec) const noexcept;
 
+	/// Opens memory mapped read channel from this file
+	/// \param ec
+	///    operation error code, contains error when file is not exist or can not be opened or mapped
+	///    or out of memory state
+	/// \param pattern
+	///    expected access pattern hint for the OS virtual memory manager \see access_pattern
+	/// \param window
+	///    size of sliding mapping window in bytes rounded to the page size,
+	///    0 to map whole file at once
+	/// \throw never throws
+	s_view_read_channel open_for_mapped_read(std::error_code& ec, access_pattern pattern, std::size_t window) const noexcept;
+
+	/// Opens memory mapped read channel from this file, file mapped at once with sequential access pattern
+	/// \param ec
+	///    operation error code, contains error when file is not exist or can not be opened or mapped
+	///    or out of memory state
+	/// \throw never throws
+	inline s_view_read_channel open_for_mapped_read(std::error_code& ec) const noexcept {
+		return open_for_mapped_read(ec, access_pattern::sequential, 0);
+	}
+
 	/// Opens blocking write channel from this file
 	/// \param ec
 	///    operation error code, contains error when file can not be opened
 	///    or out of memory state
 	/// \param mode
 	///    writing mode \see write_open_mode
+	/// \param durability
+	///    write durability policy \see write_durability
 	/// \throw never throws
-	s_write_channel open_for_write(std::error_code& ec, write_open_mode mode) const noexcept;
+	s_write_channel open_for_write(std::error_code& ec, write_open_mode mode, write_durability durability) const noexcept;
+
+	/// Opens blocking write channel from this file, each write waits for data and metadata reaches storage device
+	/// \param ec
+	///    operation error code, contains error when file can not be opened
+	///    or out of memory state
+	/// \param mode
+	///    writing mode \see write_open_mode
+	/// \throw never throws
+	inline s_write_channel open_for_write(std::error_code& ec, write_open_mode mode) const noexcept {
+		return open_for_write(ec, mode, write_durability::full_sync);
+	}
 
 	/// Opens blocking read/write and random access channel from this file
 	/// \param ec
@@ -172,8 +298,22 @@ public:
 	///    or out of memory state
 	/// \param mode
 	///    writing mode \see write_open_mode
+	/// \param durability
+	///    write durability policy \see write_durability
 	/// \throw never throws
-	s_random_access_channel open_for_random_access(std::error_code& ec, write_open_mode mode) const noexcept;
+	s_random_access_channel open_for_random_access(std::error_code& ec, write_open_mode mode, write_durability durability) const noexcept;
+
+	/// Opens blocking read/write and random access channel from this file,
+	/// writes are cached by operating system
+	/// \param ec
+	///    operation error code, contains error when can not be opened
+	///    or out of memory state
+	/// \param mode
+	///    writing mode \see write_open_mode
+	/// \throw never throws
+	inline s_random_access_channel open_for_random_access(std::error_code& ec, write_open_mode mode) const noexcept {
+		return open_for_random_access(ec, mode, write_durability::none);
+	}
 private:
 	std::string name_;
 };
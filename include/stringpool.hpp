@@ -21,7 +21,7 @@
 #include <algorithm>
 #include <ostream>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 #include "conststring.hpp"
 #include "object.hpp"
@@ -36,7 +36,9 @@ DECLARE_IPTR(string_pool);
 /// \brief A pool of raw character arrays i.e. C style strings,
 /*!
 * Allocates memory for the binary equal string only once
-* This can be used to save memory for storing string similar string objects
+* This can be used to save memory for storing string similar string objects.
+* Strings are kept in a flat open addressing hash table with linear probing, a table slot holds
+* full string hash and the cached string, so that lookup does not need node allocations and pointer chasing
 */
 class IO_PUBLIC_SYMBOL string_pool final:public object {
 	string_pool(const string_pool&) = delete;
@@ -69,27 +71,34 @@ public:
 	/// Returns count of strings cached by this pool
 	/// \return count of strings
 	inline std::size_t size() const noexcept {
-		return pool_.size();
+		return size_;
 	}
 
 private:
 	friend class nobadalloc<string_pool>;
+
+	// hash table slot, slot is free when string is empty since empty strings are never cached
+	struct entry {
+		std::size_t hash;
+		cached_string str;
+	};
+
 #ifdef __IO_WINDOWS_BACKEND__
-	typedef enclave_allocator< std::pair<const std::size_t, cached_string> > allocator_type;
+	typedef enclave_allocator<entry> allocator_type;
 #else
-	typedef h_allocator< std::pair<const std::size_t, cached_string> > allocator_type;
+	typedef h_allocator<entry> allocator_type;
 #endif // __IO_WINDOWS_BACKEND__
 
-	typedef std::unordered_map<
-		std::size_t,
-		cached_string,
-		std::hash<std::size_t>,
-		std::equal_to<std::size_t>,
-		allocator_type
-		> pool_type;
+	typedef std::vector<entry, allocator_type> table_type;
+
+	// initial count of table slots, always a power of two
+	static constexpr std::size_t INITIAL_CAPACITY = 64;
 
-	pool_type pool_;
+	std::size_t find(std::size_t hash, const char* s, std::size_t count) const noexcept;
+	bool rehash(std::size_t capacity) noexcept;
 
+	table_type table_;
+	std::size_t size_;
 };
 
 } // namespace io
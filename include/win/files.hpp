@@ -38,6 +38,8 @@ public:
 
 	virtual std::size_t write(std::error_code& ec, const uint8_t* buff,std::size_t size) const noexcept override;
 
+	virtual void flush(std::error_code& ec) const noexcept override;
+
 	virtual std::size_t forward(std::error_code& ec,std::size_t size) noexcept override;
 
 	virtual std::size_t backward(std::error_code& ec, std::size_t size) noexcept override;
@@ -66,6 +68,18 @@ enum class write_open_mode: ::DWORD
 	overwrite = CREATE_ALWAYS
 };
 
+/// \brief file writing durability policy
+enum class write_durability
+{
+	/// Writes are cached by operating system, data reaches storage device
+	/// on write_channel::flush call or on operating system discretion
+	none,
+	/// Each write goes through system cache directly to the storage device
+	data_sync,
+	/// Each write goes through system cache directly to the storage device
+	full_sync
+};
+
 /// \brief File system file operations interface, windows implementation
 class IO_PUBLIC_SYMBOL file
 {
@@ -159,8 +173,21 @@ public:
 	///    or out of memory state
 	/// \param mode
 	///    writting mode \see write_open_mode
+	/// \param durability
+	///    write durability policy \see write_durability
+	/// \throw never throws
+	s_write_channel open_for_write(std::error_code& ec, write_open_mode mode, write_durability durability) const noexcept;
+
+	/// Opens blocking write channel from this file, writes are cached by operating system
+	/// \param ec
+	///    operation error code, contains error when file can not be opened
+	///    or out of memory state
+	/// \param mode
+	///    writting mode \see write_open_mode
 	/// \throw never throws
-	s_write_channel open_for_write(std::error_code& ec, write_open_mode mode) const noexcept;
+	inline s_write_channel open_for_write(std::error_code& ec, write_open_mode mode) const noexcept {
+		return open_for_write(ec, mode, write_durability::none);
+	}
 
 	/// Opens blocking read/write and random access channel from this file
 	/// \param ec
@@ -168,8 +195,22 @@ public:
 	///    or out of memory state
 	/// \param mode
 	///    writting mode \see write_open_mode
+	/// \param durability
+	///    write durability policy \see write_durability
+	/// \throw never throws
+	s_random_access_channel open_for_random_access(std::error_code& ec, write_open_mode mode, write_durability durability) const noexcept;
+
+	/// Opens blocking read/write and random access channel from this file,
+	/// writes are cached by operating system
+	/// \param ec
+	///    operation error code, contains error when can not be opened
+	///    or out of memory state
+	/// \param mode
+	///    writting mode \see write_open_mode
 	/// \throw never throws
-	s_random_access_channel open_for_random_access(std::error_code& ec, write_open_mode mode) const noexcept;
+	inline s_random_access_channel open_for_random_access(std::error_code& ec, write_open_mode mode) const noexcept {
+		return open_for_random_access(ec, mode, write_durability::none);
+	}
 private:
 	std::wstring name_;
 };
@@ -0,0 +1,278 @@
+/*
+ *
+ * Copyright (c) 2016-2019
+ * Viktor Gubin
+ *
+ * Use, modification and distribution are subject to the
+ * Boost Software License, Version 1.0. (See accompanying file
+ * LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+#ifndef __IO_XML_DOCUMENT_HPP_INCLUDED__
+#define __IO_XML_DOCUMENT_HPP_INCLUDED__
+
+#include "config.hpp"
+
+#ifdef HAS_PRAGMA_ONCE
+#pragma once
+#endif // HAS_PRAGMA_ONCE
+
+#include "xml_parse.hpp"
+
+namespace io {
+
+namespace xml {
+
+class document;
+DECLARE_IPTR(document);
+
+/// \brief Compact read only XML document tree
+/// Document is built from event_stream_parser in a single pass. Nodes are stored in document order
+/// in a contiguous tape, so that descendants of a node are the nodes following it up to the node subtree end.
+/// Nodes, attributes, names and characters are kept in a few arena blocks addressed by indexes,
+/// there is no allocation per node and whole document is released at once.
+/// Names are interned by parser symbol ids, so that lookup by name is an integer comparison.
+/// Limitations:
+/// <ul>
+/// <li>Characters and CDATA sections are stored as text nodes, adjacent sections are joined</li>
+/// <li>Blank characters, i.e. formatting white spaces between tags are not stored</li>
+/// <li>Commentaries, DTD and processing instructions are skipped</li>
+/// <ul>
+class IO_PUBLIC_SYMBOL document final: public object {
+	document(const document&) = delete;
+	document& operator=(const document&) = delete;
+private:
+	friend class nobadalloc<document>;
+	friend class document_builder;
+
+	// no node, name or attribute index
+	static constexpr uint32_t NPOS = UINT32_MAX;
+
+	// qualified name raw characters i.e. prefix:local_name
+	struct name_rec {
+		symbol_id id;
+		uint32_t str;
+		uint32_t len;
+		uint32_t prefix_len;
+	};
+
+	// element or text node, text nodes have no name and
+	// reference characters instead of attributes
+	struct node_rec {
+		symbol_id id;
+		uint32_t name;
+		uint32_t parent;
+		// index after the last descendant
+		uint32_t end;
+		// first attribute index or text offset
+		uint32_t first;
+		// attributes count or text length
+		uint32_t count;
+	};
+
+	struct attr_rec {
+		symbol_id id;
+		uint32_t name;
+		uint32_t value;
+		uint32_t value_len;
+	};
+
+	document() noexcept;
+
+public:
+
+	class node;
+
+	/// \brief Element attribute reference, valid while document is alive
+	class IO_PUBLIC_SYMBOL node_attribute {
+	public:
+		constexpr node_attribute() noexcept:
+			doc_(nullptr),
+			idx_(0)
+		{}
+		explicit operator bool() const noexcept {
+			return nullptr != doc_;
+		}
+		/// Returns attribute name symbol id
+		inline symbol_id id() const noexcept {
+			return doc_->attrs_[idx_].id;
+		}
+		/// Returns qualified attribute name i.e. prefix:local_name
+		inline char_view name() const noexcept {
+			return doc_->qualified_name( doc_->attrs_[idx_].name );
+		}
+		/// Returns attribute name space prefix, or empty view when name has no prefix
+		inline char_view prefix() const noexcept {
+			return doc_->name_prefix( doc_->attrs_[idx_].name );
+		}
+		/// Returns attribute local name
+		inline char_view local_name() const noexcept {
+			return doc_->local_name( doc_->attrs_[idx_].name );
+		}
+		/// Returns attribute value
+		inline char_view value() const noexcept {
+			const attr_rec& a = doc_->attrs_[idx_];
+			return char_view( doc_->chars_ + a.value, static_cast<std::size_t>(a.value_len) );
+		}
+	private:
+		friend class node;
+		constexpr node_attribute(const document* doc, uint32_t idx) noexcept:
+			doc_(doc),
+			idx_(idx)
+		{}
+		const document* doc_;
+		uint32_t idx_;
+	};
+
+	/// \brief Document node reference, element or text. Valid while document is alive
+	class IO_PUBLIC_SYMBOL node {
+	public:
+		constexpr node() noexcept:
+			doc_(nullptr),
+			idx_(0)
+		{}
+		explicit operator bool() const noexcept {
+			return nullptr != doc_;
+		}
+		inline bool operator==(const node& rhs) const noexcept {
+			return doc_ == rhs.doc_ && idx_ == rhs.idx_;
+		}
+		inline bool operator!=(const node& rhs) const noexcept {
+			return !(*this == rhs);
+		}
+		/// Returns node index in the document order, root element has index 0
+		inline std::size_t index() const noexcept {
+			return static_cast<std::size_t>(idx_);
+		}
+		/// Returns whether this is an element node
+		inline bool is_element() const noexcept {
+			return NPOS != rec().name;
+		}
+		/// Returns whether this is a text node
+		inline bool is_text() const noexcept {
+			return NPOS == rec().name;
+		}
+		/// Returns element name symbol id, NO_SYMBOL for text nodes
+		inline symbol_id id() const noexcept {
+			return rec().id;
+		}
+		/// Returns qualified element name i.e. prefix:local_name, empty view for text nodes
+		inline char_view name() const noexcept {
+			return doc_->qualified_name( rec().name );
+		}
+		/// Returns element name space prefix, empty view when name has no prefix
+		inline char_view prefix() const noexcept {
+			return doc_->name_prefix( rec().name );
+		}
+		/// Returns element local name, empty view for text nodes
+		inline char_view local_name() const noexcept {
+			return doc_->local_name( rec().name );
+		}
+		/// Returns text node characters, or characters of the first element text child
+		/// i.e. value of the simple elements like <tag>value</tag>
+		char_view text() const noexcept;
+		/// Returns parent element, or empty node for the root element
+		node parent() const noexcept;
+		/// Returns first child node, or empty node when there are no children
+		node first_child() const noexcept;
+		/// Returns next sibling node, or empty node when this is the last child
+		node next_sibling() const noexcept;
+		/// Finds first child element with the name
+		/// \param id element name symbol id
+		/// \return found element, or empty node
+		node first_child(symbol_id id) const noexcept;
+		/// Finds next sibling element with the name
+		/// \param id element name symbol id
+		/// \return found element, or empty node
+		node next_sibling(symbol_id id) const noexcept;
+		/// Returns count of element attributes
+		inline std::size_t attributes_count() const noexcept {
+			return is_element() ? static_cast<std::size_t>( rec().count ) : 0;
+		}
+		/// Returns attribute by index, attributes ordered by name
+		/// \param i attribute index in [0,attributes_count())
+		inline node_attribute attribute_at(std::size_t i) const noexcept {
+			return node_attribute(doc_, rec().first + static_cast<uint32_t>(i) );
+		}
+		/// Finds attribute by name
+		/// \param id attribute name symbol id
+		/// \return found attribute, or empty attribute
+		node_attribute attribute(symbol_id id) const noexcept;
+	private:
+		friend class document;
+		constexpr node(const document* doc, uint32_t idx) noexcept:
+			doc_(doc),
+			idx_(idx)
+		{}
+		inline const node_rec& rec() const noexcept {
+			return doc_->nodes_[idx_];
+		}
+		const document* doc_;
+		uint32_t idx_;
+	};
+
+	/// Builds document from the parser, parser is scanned from the current position until the end of document
+	/// \param ec operation error code, contains parser error or out of memory error
+	/// \param parser XML parser
+	/// \return document smart pointer, or empty pointer in case of error
+	/// \throw never throws
+	static s_document parse(std::error_code& ec, const s_event_stream_parser& parser) noexcept;
+
+	/// Builds document from a read channel
+	/// \param ec operation error code, contains parser error or out of memory error
+	/// \param src XML source channel
+	/// \return document smart pointer, or empty pointer in case of error
+	/// \throw never throws
+	static s_document parse(std::error_code& ec, s_read_channel&& src) noexcept;
+
+	virtual ~document() noexcept override;
+
+	/// Returns root element
+	inline node root() const noexcept {
+		return 0 == nodes_count_ ? node() : node(this, 0);
+	}
+
+	/// Returns total count of element and text nodes
+	inline std::size_t size() const noexcept {
+		return static_cast<std::size_t>(nodes_count_);
+	}
+
+	/// Returns node by document order index
+	/// \param i node index in [0,size())
+	inline node at(std::size_t i) const noexcept {
+		return node(this, static_cast<uint32_t>(i) );
+	}
+
+	/// Returns symbol id of the qualified name met in this document
+	/// \param prefix name space prefix, empty string or nullptr for names without prefix
+	/// \param local_name local name
+	/// \return symbol id, or NO_SYMBOL when there is no such name in document
+	symbol_id symbol(const char* prefix, const char* local_name) const noexcept;
+
+	/// Finds first element with the name in document order, starting after a node
+	/// \param id element name symbol id
+	/// \param after node to start search after, or empty node to search from the root
+	/// \return found element, or empty node
+	node find(symbol_id id, const node& after = node() ) const noexcept;
+
+private:
+	char_view qualified_name(uint32_t name) const noexcept;
+	char_view name_prefix(uint32_t name) const noexcept;
+	char_view local_name(uint32_t name) const noexcept;
+
+	node_rec* nodes_;
+	uint32_t nodes_count_;
+	attr_rec* attrs_;
+	name_rec* names_;
+	uint32_t names_count_;
+	// open addressing names hash table, contains name index + 1 or 0 for empty slot
+	uint32_t* names_index_;
+	uint32_t names_mask_;
+	char* chars_;
+};
+
+} // namespace xml
+
+} // namespace io
+
+#endif // __IO_XML_DOCUMENT_HPP_INCLUDED__
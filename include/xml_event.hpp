@@ -21,7 +21,6 @@
 
 #include <algorithm>
 #include <functional>
-#include <set>
 
 namespace io {
 
@@ -85,7 +84,15 @@ private:
 	const_string data_;
 };
 
-class event_stream_parser;
+/// Small integer identifier of a qualified name, unique inside a parser
+typedef uint32_t symbol_id;
+
+/// Symbol id of a qualified name which is not known by a parser
+static constexpr symbol_id NO_SYMBOL = 0;
+
+/// First symbol id assigned by parser to names which were not registered by user,
+/// user defined ids must be in [1, FIRST_DYNAMIC_SYMBOL) range
+static constexpr symbol_id FIRST_DYNAMIC_SYMBOL = 0x10000;
 
 /// \brief qualified name
 class qname final {
@@ -93,16 +100,24 @@ public:
 
 	constexpr qname() noexcept:
 		prefix_(),
-		local_name_()
+		local_name_(),
+		id_(NO_SYMBOL)
 	{}
 
 	qname(const cached_string& p,const cached_string& n) noexcept:
 		prefix_(p),
-		local_name_(n)
+		local_name_(n),
+		id_(NO_SYMBOL)
+	{}
+
+	qname(const cached_string& p,const cached_string& n, symbol_id id) noexcept:
+		prefix_(p),
+		local_name_(n),
+		id_(id)
 	{}
 
 	qname(const qname& other) noexcept:
-		qname(other.prefix_, other.local_name_)
+		qname(other.prefix_, other.local_name_, other.id_)
 	{}
 
 	qname& operator=(const qname& rhs) noexcept
@@ -113,7 +128,8 @@ public:
 
 	qname(qname&& other) noexcept:
 		prefix_( std::move( other.prefix_) ),
-		local_name_( std::move( other.local_name_) )
+		local_name_( std::move( other.local_name_) ),
+		id_( other.id_ )
 	{}
 
 	qname& operator=(qname&& rhs) noexcept
@@ -127,6 +143,7 @@ public:
 	inline void swap(qname& other) noexcept {
 		prefix_.swap( other.prefix_ );
 		local_name_.swap( other.local_name_ );
+		std::swap(id_, other.id_);
 	}
 
 	/// Returns whether this name contains name space prefix
@@ -148,6 +165,13 @@ public:
 		return local_name_;
 	}
 
+	/// Returns symbol id assigned to this name by parser, the same names always have the same id
+	/// inside a parser, so that names can be compared or dispatched with switch by id
+	/// \return symbol id or NO_SYMBOL when name was not produced by a parser
+	inline symbol_id id() const noexcept {
+		return id_;
+	}
+
 	inline bool operator==(const qname& rhs) const noexcept {
 		return prefix_ == rhs.prefix_ && local_name_ == rhs.local_name_;
 	}
@@ -163,9 +187,15 @@ public:
         return prefix_.equal(prefix) && local_name_.equal(name);
 	}
 
+	inline bool equal(const char* prefix, std::size_t prefix_len, const char* name, std::size_t name_len) const noexcept
+	{
+        return prefix_.equal(prefix, prefix_len) && local_name_.equal(name, name_len);
+	}
+
 private:
 	cached_string prefix_;
 	cached_string local_name_;
+	symbol_id id_;
 };
 
 /// \brief XML tag attribute
@@ -191,7 +221,7 @@ public:
 
 	/// Returns attribute name
 	/// \return attribute name
-	inline qname name() const noexcept {
+	inline const qname& name() const noexcept {
 		return name_;
 	}
 
@@ -216,33 +246,21 @@ private:
 };
 
 
+/// \brief XML start element event
+/// Attributes are stored in a flat array sorted by attribute name,
+/// first INLINE_ATTRIBUTES attributes are stored inside event object without heap allocation
 class IO_PUBLIC_SYMBOL start_element_event final {
-private:
-
-	struct attr_less
-	{
-      	typedef attribute first_argument_type;
-
-      	typedef attribute second_argument_type;
-
-      	typedef bool result_type;
-
-     	inline result_type operator()(const first_argument_type& lsh, const second_argument_type& rhs) const noexcept
-     	{
-     		return lsh.name() < rhs.name();
-     	}
-	};
-
-	typedef std::set<attribute, attr_less, h_allocator<attribute> > attrs_storage;
-
 public:
-	typedef attrs_storage::const_iterator iterator;
+	/// Count of attributes stored without heap allocation
+	static constexpr std::size_t INLINE_ATTRIBUTES = 8;
+
+	typedef const attribute* iterator;
 
 	start_element_event(const start_element_event& rhs) = delete;
 	start_element_event& operator=(const start_element_event& rhs) = delete;
 
 	start_element_event() noexcept;
-	~start_element_event() noexcept = default;
+	~start_element_event() noexcept;
 
 	start_element_event(qname&& name, bool empty_element) noexcept;
 	start_element_event(start_element_event&& rhs) noexcept;
@@ -256,6 +274,9 @@ public:
 		return !name_.local_name().empty();
 	}
 
+	/// Adds an attribute to this event
+	/// \param attr attribute to add
+	/// \return false when attribute with the same name already present or out of memory
 	bool add_attribute(attribute&& attr) noexcept;
 
 	inline bool empty_element() const noexcept {
@@ -267,30 +288,40 @@ public:
 	}
 
 	inline bool has_attributes() const noexcept {
-		return !attributes_.empty();
+		return 0 != size_;
+	}
+
+	/// Returns count of attributes
+	inline std::size_t attributes_count() const noexcept {
+		return size_;
 	}
 
 	// returns iterator on first attribute
 	inline iterator attr_begin() const noexcept {
-		return attributes_.cbegin();
+		return attrs_;
 	}
 
 	// returns iterator on last attribute
 	inline iterator attr_end() const noexcept {
-		return attributes_.cend();
+		return attrs_ + size_;
 	}
 
 	std::pair<const_string, bool> get_attribute(const char* prefix, const char* local_name) const noexcept;
 
-	inline void swap(start_element_event& other) noexcept {
-		name_.swap(other.name_);
-		attributes_.swap(other.attributes_);
-		std::swap(empty_element_, other.empty_element_);
+	void swap(start_element_event& other) noexcept;
+
+private:
+	inline bool is_inline() const noexcept {
+		return attrs_ == inline_attrs_;
 	}
+	bool grow() noexcept;
 
 private:
 	qname name_;
-	attrs_storage attributes_;
+	attribute* attrs_;
+	std::size_t size_;
+	std::size_t capacity_;
+	attribute inline_attrs_[INLINE_ATTRIBUTES];
 	bool empty_element_;
 };
 
@@ -0,0 +1,224 @@
+/*
+ *
+ * Copyright (c) 2016-2019
+ * Viktor Gubin
+ *
+ * Use, modification and distribution are subject to the
+ * Boost Software License, Version 1.0. (See accompanying file
+ * LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+#ifndef __IO_XML_PARALLEL_HPP_INCLUDED__
+#define __IO_XML_PARALLEL_HPP_INCLUDED__
+
+#include "config.hpp"
+
+#ifdef HAS_PRAGMA_ONCE
+#pragma once
+#endif // HAS_PRAGMA_ONCE
+
+#include "xml_parse.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace io {
+
+namespace xml {
+
+/// Order of parsed chunks delivery
+enum class chunks_order {
+	/// chunks are delivered in document order
+	document,
+	/// chunks are delivered as soon as they are parsed and all previous chunks are parsed successfully
+	unordered
+};
+
+/// \brief Records handler of the parallel parser
+/// Records of a chunk are handled on a pool thread, different chunks are handled on different threads concurrently.
+/// A chunk can be parsed more than once when speculative split of the document was wrong,
+/// so handler should not publish any results until chunk is delivered by #end_chunk
+class IO_PUBLIC_SYMBOL record_handler {
+public:
+	virtual ~record_handler() noexcept = default;
+
+	/// Called on a pool thread before parsing chunk records,
+	/// results of the previous chunk parsing attempt if any should be dropped
+	/// \param chunk chunk index
+	virtual void begin_chunk(std::size_t chunk) noexcept = 0;
+
+	/// Called on a pool thread for every record in the chunk
+	/// \param ec error code to stop parsing with
+	/// \param chunk chunk index
+	/// \param record record start element event
+	/// \param parser chunk parser positioned after the record start tag, handler may parse any part of the record content
+	///  and the rest is skipped. Parser symbol ids are local to a chunk
+	virtual void record(std::error_code& ec, std::size_t chunk, const start_element_event& record, const s_event_stream_parser& parser) noexcept = 0;
+
+	/// Called on the thread running the parser, when all chunk records are parsed and chunk boundaries are validated.
+	/// Chunks which were merged into previous chunk are never delivered
+	/// \param chunk chunk index
+	virtual void end_chunk(std::size_t chunk) noexcept = 0;
+};
+
+class parallel_parser;
+DECLARE_IPTR(parallel_parser);
+
+/// \brief Parallel parser of large record oriented XML documents, i.e. a root element with a lot of
+/// sibling record elements like <feed><entry>...</entry><entry>...</entry>...</feed>
+/// Document is split into chunks at the record start tags found by raw scanning, and chunks are parsed
+/// on a pool of threads with per thread string pools and per chunk parsers.
+/// Splits are speculative, since a record start tag can be met in a commentary or CDATA section. Split is valid when
+/// the previous chunk is parsed up to the end with all records closed, otherwise two chunks are merged and parsed again.
+/// Limitations:
+/// <ul>
+/// <li>Whole document should be exposed by a single view of the channel, i.e. a file mapped without window or a memory channel</li>
+/// <li>Only UTF-8 compatible documents are split, other documents are parsed as a single chunk</li>
+/// <li>Records are expected on the same nesting level, the level of the first record in the document</li>
+/// </ul>
+class IO_PUBLIC_SYMBOL parallel_parser final: public object {
+	parallel_parser(const parallel_parser&) = delete;
+	parallel_parser& operator=(const parallel_parser&) = delete;
+private:
+	friend class nobadalloc<parallel_parser>;
+
+	enum class chunk_status {
+		// not parsed yet
+		pending,
+		// parsed up to the end, all records closed
+		ok,
+		// parsing error at the end of chunk, i.e. split is inside a commentary, CDATA section or record
+		truncated,
+		// parsing error before the end of chunk
+		failed,
+		// stopped by the records handler
+		aborted,
+		// merged into previous chunk
+		merged
+	};
+
+	struct chunk {
+		const uint8_t* begin;
+		const uint8_t* end;
+		chunk_status status;
+		std::error_code ec;
+		bool delivered;
+		unsigned int merges;
+	};
+
+	typedef std::vector<chunk, h_allocator<chunk> > chunks_vector;
+
+	parallel_parser(s_view_read_channel&& src, chunks_vector&& chunks, const_string&& record, unsigned int threads) noexcept;
+
+	static bool split(std::error_code& ec, const uint8_t* b, const uint8_t* e, const const_string& record, std::size_t count, chunks_vector& chunks) noexcept;
+	chunk_status parse_chunk(std::size_t idx, const s_string_pool& pool, record_handler& handler) noexcept;
+	std::size_t validated_prefix(std::size_t from) const noexcept;
+	void parse_concurrent(record_handler& handler, chunks_order order) noexcept;
+	void complete(std::error_code& ec, record_handler& handler) noexcept;
+
+public:
+
+	/// Minimal size of a chunk, smaller documents are not split
+	static constexpr std::size_t MIN_CHUNK_SIZE = 256 * 1024;
+
+	/// Count of chunks per a pool thread, for threads load balancing
+	static constexpr std::size_t CHUNKS_PER_THREAD = 4;
+
+	/// Opens parallel parser, and splits document into chunks
+	/// \param ec operation error code
+	/// \param src document source channel, which exposes whole document in a single view i.e. memory mapped file
+	/// \param record record element qualified name i.e. entry or atom:entry
+	/// \param threads count of pool threads, 0 for the hardware concurrency
+	/// \return parallel parser, or empty pointer in case of error
+	/// \throw never throws
+	static s_parallel_parser open(std::error_code& ec, s_view_read_channel&& src, const char* record, unsigned int threads = 0) noexcept;
+
+	virtual ~parallel_parser() noexcept override;
+
+	/// Returns count of chunks document was split
+	inline std::size_t chunks_count() const noexcept {
+		return chunks_.size();
+	}
+
+	/// Returns count of pool threads
+	inline unsigned int threads() const noexcept {
+		return threads_;
+	}
+
+	/// Parses all chunks, returns when all chunks are delivered or an error occurred
+	/// \param ec operation error code, contains parsing error, records handler error or out of memory error
+	/// \param handler records handler
+	/// \param order chunks delivery order
+	/// \throw never throws
+	void run(std::error_code& ec, record_handler& handler, chunks_order order) noexcept;
+
+private:
+	s_view_read_channel src_;
+	chunks_vector chunks_;
+	// record element qualified name
+	const_string record_;
+	unsigned int threads_;
+};
+
+/// \brief Records handler which maps every record into a result on pool threads,
+/// and passes chunk results to a consumer on the thread running the parser
+template<typename R>
+class record_results final: public record_handler {
+	record_results(const record_results&) = delete;
+	record_results& operator=(const record_results&) = delete;
+public:
+	/// Record mapping function, called on a pool thread
+	typedef std::function<R(std::error_code&, const start_element_event&, const s_event_stream_parser&)> mapper;
+	/// Results consumer, called on the thread running the parser in chunks delivery order
+	typedef std::function<void(std::size_t, R&&)> consumer;
+
+	/// Creates records results handler
+	/// \param chunks count of parser chunks
+	/// \param map record mapping function
+	/// \param consume results consumer
+	/// \throw std::bad_alloc
+	record_results(std::size_t chunks, const mapper& map, const consumer& consume):
+		record_handler(),
+		map_(map),
+		consume_(consume),
+		results_(chunks)
+	{}
+
+	virtual void begin_chunk(std::size_t chunk) noexcept override
+	{
+		results_[chunk].clear();
+	}
+
+	virtual void record(std::error_code& ec, std::size_t chunk, const start_element_event& record, const s_event_stream_parser& parser) noexcept override
+	{
+#ifndef IO_NO_EXCEPTIONS
+		try {
+#endif // IO_NO_EXCEPTIONS
+			R result = map_(ec, record, parser);
+			if(!ec)
+				results_[chunk].emplace_back( std::move(result) );
+#ifndef IO_NO_EXCEPTIONS
+		} catch(std::bad_alloc&) {
+			ec = std::make_error_code(std::errc::not_enough_memory);
+		}
+#endif // IO_NO_EXCEPTIONS
+	}
+
+	virtual void end_chunk(std::size_t chunk) noexcept override
+	{
+		for(R& result: results_[chunk])
+			consume_(chunk, std::move(result) );
+		std::vector<R>().swap(results_[chunk]);
+	}
+
+private:
+	mapper map_;
+	consumer consume_;
+	std::vector< std::vector<R> > results_;
+};
+
+} // namespace xml
+
+} // namespace io
+
+#endif // __IO_XML_PARALLEL_HPP_INCLUDED__
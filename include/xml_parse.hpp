@@ -43,11 +43,42 @@ enum class state_type {
 	event
 };
 
+/// \brief Compile time selection of the parser features, see basic_event_stream_parser
+/// \param ValidateNames whether element and attribute names are checked according to XML name syntax
+/// \param Namespaces whether qualified names are split into name space prefix and local name,
+///  otherwise prefix:name is a local name without prefix
+/// \param Dtd whether DTD declaration is accepted, otherwise a document with DTD is rejected with illegal_dtd error
+template<bool ValidateNames, bool Namespaces, bool Dtd>
+struct parser_policies {
+	static constexpr bool validate_names = ValidateNames;
+	static constexpr bool namespaces = Namespaces;
+	static constexpr bool dtd = Dtd;
+};
+
+/// Fully validating parser features, default for event_stream_parser
+typedef parser_policies<true, true, true> validating_policies;
+
+/// Features for trusted well formed documents, i.e. produced by own services, names are not validated and DTD is rejected
+typedef parser_policies<false, true, false> trusted_policies;
 
-class event_stream_parser;
+/// Features for trusted documents without name spaces, qualified names are not split
+typedef parser_policies<false, false, false> raw_policies;
 
+template<class Policies>
+class basic_event_stream_parser;
+
+/// Fully validating parser
+typedef basic_event_stream_parser<validating_policies> event_stream_parser;
 DECLARE_IPTR(event_stream_parser);
 
+/// Parser for trusted documents
+typedef basic_event_stream_parser<trusted_policies> trusted_event_stream_parser;
+DECLARE_IPTR(trusted_event_stream_parser);
+
+/// Parser for trusted documents without name spaces
+typedef basic_event_stream_parser<raw_policies> raw_event_stream_parser;
+DECLARE_IPTR(raw_event_stream_parser);
+
 /// \brief XML streaming API for XML parsing (StAX) LL parser
 /// Unlike SAX/SAX2 this is controlled parser, i.e. no any callbacks required
 /// You can build your own SAX/DOM implementation on top of it.
@@ -57,9 +88,18 @@ DECLARE_IPTR(event_stream_parser);
 /// <li>DTD including embedded and external is ignored, but can be extracted for later usage</li>
 /// <li>XML attribute values are always interpreted as #CDATA attribute, with white spaces normalization
 ///  e.g. &nbsp; must be converted manually to ' ' </li>
+/// <li>Only predefined entities (&amp;amp; &amp;lt; &amp;gt; &amp;quot; &amp;apos;) and numeric character references
+///  are decoded in characters and attribute values, DTD declared entities are left as is.
+///  CDATA sections and commentaries are never decoded</li>
 /// <li>No XML validation neither DTD neither XSD schema since parsing</li>
 /// <ul>
-class IO_PUBLIC_SYMBOL event_stream_parser:public object {
+/// Parser features are selected at compile time by Policies i.e. parser_policies, so that disabled features
+/// cost nothing. Parser is instantiated by the library for validating_policies, trusted_policies and raw_policies only
+template<class Policies>
+class IO_PUBLIC_SYMBOL basic_event_stream_parser:public object {
+public:
+	/// Smart pointer on this parser type
+	typedef boost::intrusive_ptr<basic_event_stream_parser> s_parser;
 private:
 
 	// XML parser state
@@ -86,35 +126,84 @@ private:
 		std::equal_to<std::size_t>,
 		io::h_allocator<std::size_t> > validated_set;
 
-	friend class nobadalloc<event_stream_parser>;
-	event_stream_parser(const event_stream_parser&) = delete;
-	event_stream_parser& operator=(const event_stream_parser&) = delete;
-	event_stream_parser(s_source&& src, s_string_pool&& pool) noexcept;
+	// symbols table slot, slot is free when symbol id is NO_SYMBOL since stored symbols always have an id
+	struct symbol_entry {
+		std::size_t hash;
+		qname name;
+	};
+
+	// flat open addressing hash table with linear probing, like the string pool
+	typedef std::vector<symbol_entry, io::h_allocator<symbol_entry> > symbols_table;
+
+	// initial count of symbols table slots, always a power of two
+	static constexpr std::size_t SYMBOLS_INITIAL_CAPACITY = 64;
+
+	// symbols of attribute names met in the current start tag
+	typedef std::vector<symbol_id, io::h_allocator<symbol_id> > tag_symbols;
+
+	friend class nobadalloc<basic_event_stream_parser>;
+	basic_event_stream_parser(const basic_event_stream_parser&) = delete;
+	basic_event_stream_parser& operator=(const basic_event_stream_parser&) = delete;
+	basic_event_stream_parser(s_source&& src, s_string_pool&& pool) noexcept;
 public:
 
 	/// Constructs new XML parser from an XML source
 	/// \param ec contains system error code when parser can not be constructed,
 	/// 		for example in case of out of memory or nullptr pointed source
 	/// \param source an XML source data
-	static s_event_stream_parser open(std::error_code& ec,s_source&& src) noexcept;
+	static s_parser open(std::error_code& ec,s_source&& src) noexcept;
 
 	/// Constructs new XML parser from an read_channel
 	/// \param ec contains system error code when parser can not be constructed,
 	/// 		for example in case of out of memory or nullptr pointed source
 	/// \param src an XML source data
-	static s_event_stream_parser open(std::error_code& ec,s_read_channel&& src) noexcept;
+	static s_parser open(std::error_code& ec,s_read_channel&& src) noexcept;
 
 	/// Constructs new XML parser from an read_channel
 	/// \param ec contains system error code when parser can not be constructed,
 	/// 		for example in case of out of memory or nullptr pointed source
 	/// \param src an XML source data
-	inline static s_event_stream_parser open(std::error_code& ec,const s_read_channel& src) noexcept
+	inline static s_parser open(std::error_code& ec,const s_read_channel& src) noexcept
 	{
 		return open(ec, s_read_channel(src) );
 	}
 
+	/// Constructs new XML parser from a view read channel, i.e. memory mapped file
+	/// UTF-8 documents are scanned in place without copying
+	/// \param ec contains system error code when parser can not be constructed,
+	/// 		for example in case of out of memory or nullptr pointed source
+	/// \param src an XML source data
+	static s_parser open(std::error_code& ec,s_view_read_channel&& src) noexcept;
+
+	/// Constructs new XML parser from a view read channel, sharing an existing string pool
+	/// i.e. a pool owned by a thread which parses several documents one by one.
+	/// String pool is not thread safe, and should not be used by parsers from different threads
+	/// \param ec contains system error code when parser can not be constructed
+	/// \param src an XML source data
+	/// \param pool string pool to cache names and values
+	static s_parser open(std::error_code& ec,s_view_read_channel&& src, const s_string_pool& pool) noexcept;
+
 	/// Destroy parser and releases associated resources
-	virtual ~event_stream_parser() noexcept override;
+	virtual ~basic_event_stream_parser() noexcept override;
+
+	/// Resets parser to the beginning of a next document from another XML source.
+	/// String pool, registered symbols and names validation cache are kept, so that parsing a lot of small documents
+	/// one by one costs near to no memory allocations. Symbols of names met in the previous document are dropped,
+	/// so ids of not registered names are valid until the next reset only
+	/// \param ec contains system error code when parser can not be reset, i.e. nullptr pointed source
+	/// \param src an XML source data
+	void reset(std::error_code& ec,s_source&& src) noexcept;
+
+	/// Resets parser to the beginning of a next document from a read channel,
+	/// current source read buffer is reused as well
+	/// \param ec contains system error code when parser can not be reset, i.e. in case of input output error
+	/// \param src an XML source data
+	void reset(std::error_code& ec,s_read_channel&& src) noexcept;
+
+	/// Resets parser to the beginning of a next document from a view read channel, i.e. memory mapped file
+	/// \param ec contains system error code when parser can not be reset, i.e. in case of input output error
+	/// \param src an XML source data
+	void reset(std::error_code& ec,s_view_read_channel&& src) noexcept;
 
 	/// Scan XML source from current position to find next XML entity or characters
 	/// \return parser state after scanning
@@ -138,6 +227,12 @@ public:
 		return current_;
 	}
 
+	/// Returns count of currently open elements
+	/// \return elements nesting depth, 0 outside of the root element
+	inline std::size_t depth() const noexcept {
+		return nesting_;
+	}
+
 	/// Current XML source line
 	/// \return source line
 	inline std::size_t row() const noexcept {
@@ -150,11 +245,37 @@ public:
 		return src_->col();
 	}
 
+	/// Current XML source byte offset
+	/// \return count of consumed source bytes
+	inline std::size_t position() const noexcept {
+		return src_->position();
+	}
+
 	/// Pre-cache a string like tag or attribute local name in the parser string pool
 	/// \param str a string to pre-cache in the parsing pool
 	/// \return new cached string object
 	cached_string precache(const char* str) noexcept;
 
+	/// Registers a qualified name with user defined symbol id, so that parsed element and attribute
+	/// names can be matched by qname#id integer comparison or switch. Should be called before parsing
+	/// \param id symbol id in [1, FIRST_DYNAMIC_SYMBOL) range
+	/// \param prefix name space prefix, empty string or nullptr for names without prefix
+	/// \param local_name local name
+	/// \return false when id is out of range, name is already registered or out of memory
+	bool register_symbol(symbol_id id, const char* prefix, const char* local_name) noexcept;
+
+	/// Returns symbol id of a qualified name, names which were not met yet are registered with a dynamic id
+	/// \param prefix name space prefix, empty string or nullptr for names without prefix
+	/// \param local_name local name
+	/// \return symbol id, or NO_SYMBOL when out of memory
+	symbol_id symbol(const char* prefix, const char* local_name) noexcept;
+
+	/// Returns symbol id of a qualified name without registering it
+	/// \param prefix name space prefix, empty string or nullptr for names without prefix
+	/// \param local_name local name
+	/// \return symbol id, or NO_SYMBOL when the name is not registered and was not met yet
+	symbol_id lookup_symbol(const char* prefix, const char* local_name) const noexcept;
+
 	/// Parse XML prologue declaration into document_event structure
 	/// \return extracted document_event
 	document_event parse_start_doc() noexcept;
@@ -167,10 +288,38 @@ public:
 	/// \return extracted start_element_event
 	start_element_event parse_start_element() noexcept;
 
+	/// Skips an element with all nested content up to the matching end tag,
+	/// without parsing attributes and building events or strings.
+	/// When called on start element event instead of #parse_start_element skips whole element,
+	/// when called after #parse_start_element of not self closed element or on it's characters
+	/// skips the rest of element content including end tag.
+	/// Only the markup required to find the matching end tag i.e. quoted attribute values, comments,
+	/// CDATA sections and processing instructions is recognized, skipped content is not validated
+	void skip_subtree() noexcept;
+
 	/// Parse tag close declaration into end_element_event structure
 	/// \return extracted end_element_event
 	end_element_event parse_end_element() noexcept;
 
+	/// Reads start tag into parser owned buffer, without building start_element_event and interning names.
+	/// Used instead of #parse_start_element by callback front ends, see sax::parse
+	/// \param empty_element set to true for self closed element
+	/// \return view on the raw qualified element name i.e. prefix:local_name, valid until the next parser call
+	///  except #next_attribute_view
+	char_view read_start_element_view(bool& empty_element) noexcept;
+
+	/// Extracts next attribute of the start tag read by #read_start_element_view,
+	/// attribute value is normalized and references are decoded. When names are validated, several attributes
+	/// with the same name are reported as error::illegal_attribute, like by #parse_start_element
+	/// \param name view on the raw qualified attribute name
+	/// \param value view on the attribute value
+	/// \return false when there are no more attributes or in case of error
+	bool next_attribute_view(char_view& name, char_view& value) noexcept;
+
+	/// Reads end tag without building end_element_event and interning names
+	/// \return view on the raw qualified element name, valid until the next parser call
+	char_view read_end_element_view() noexcept;
+
 	/// Extracts raw unformated XML DTD declaration into memory buffer
 	/// \return extracted DTD
 	const_string read_dtd() noexcept;
@@ -182,22 +331,43 @@ public:
 	/// \return extracted commentary body
 	const_string read_comment() noexcept;
 
+	/// Extracts raw unformated XML commentary without copying it, when possible
+	/// \return view on commentary body, valid until the next parser call
+	char_view read_comment_view() noexcept;
+
 	/// Skips XML commentary
 	void skip_comment() noexcept;
 
 	/// Extracts normalized XML characters, i.e. tag body
 	const_string read_chars() noexcept;
 
+	/// Extracts normalized XML characters, i.e. tag body, without copying them when possible.
+	/// Characters are referenced in the source read buffer when they are contiguous and don't need
+	/// line endings normalization or references decoding, otherwise they are copied into parser owned buffer
+	/// \return view on characters, valid until the next parser call
+	char_view read_chars_view() noexcept;
+
 	/// Skip characters until next tag declaration e.g. '>  <next-tag>' or ' lorem ipsum <![CDATA[ <some data> ]]>'
 	void skip_chars() noexcept;
 
+	/// Skips white space characters between tags i.e. formatting of a pretty printed document, without copying them
+	/// \return true when characters are blank and skipped, false in case of error or when a non white space character met,
+	///  in this case parser stays in characters state and the rest of characters can be read or skipped as usual
+	bool skip_blank_chars() noexcept;
+
 	/// Extract raw XML characters declared in <!CDATA[]]> section
 	/// \return CDATA section content
 	const_string read_cdata() noexcept;
 
+	/// Extract raw XML characters declared in <!CDATA[]]> section without copying them, when possible
+	/// \return view on CDATA section content, valid until the next parser call
+	char_view read_cdata_view() noexcept;
+
 
 private:
 
+	void start() noexcept;
+	void restart(const std::error_code& ec) noexcept;
 	void scan() noexcept;
 	void s_instruction_or_prologue() noexcept;
 	void s_comment_cdata_or_dtd() noexcept;
@@ -218,13 +388,28 @@ private:
 
 	//char skip_to_symbol(char symbol) noexcept;
 	byte_buffer read_entity() noexcept;
-	byte_buffer read_until_double_separator(const char separator,const error ec) noexcept;
-
+	char_view read_until_double_separator(const char separator,const error ec) noexcept;
+	inline bool clear_text() noexcept;
+	void skip_failed() noexcept;
+	bool skip_start_tag() noexcept;
+	bool skip_until_terminator(const char separator, bool twice) noexcept;
+	char_view decode_text(const char_view& v) noexcept;
+
+	std::size_t symbol_slot(std::size_t hash, const char* prefix, std::size_t prefix_len, const char* local_name, std::size_t local_name_len) const noexcept;
+	const qname* find_symbol(std::size_t hash, const char* prefix, std::size_t prefix_len, const char* local_name, std::size_t local_name_len) const noexcept;
+	bool rehash_symbols(std::size_t capacity, bool keep_dynamic) noexcept;
+	bool add_symbol(std::size_t hash, const qname& name) noexcept;
+	void drop_dynamic_symbols() noexcept;
+	qname intern_qname(const char* prefix, std::size_t prefix_len, const char* local_name, std::size_t local_name_len) noexcept;
 	qname extract_qname(const char* from, std::size_t& len) noexcept;
 	attribute extract_attribute(const char* from, std::size_t& len) noexcept;
+	bool extract_attribute_view(const char* from, std::size_t& len, char_view& name, char_view& value) noexcept;
+	qname intern_attribute_name(const char_view& raw) noexcept;
+	std::size_t read_tag() noexcept;
 	bool validate_attr_name(const qname& name) noexcept;
 	bool validate_element_name(const qname& name) noexcept;
-	bool validate_xml_name(const cached_string& str, bool attr) noexcept;
+	bool validate_xml_name(const qname& name, bool attr) noexcept;
+	bool add_tag_attribute(const qname& name) noexcept;
 
 	inline char next() noexcept;
 
@@ -259,10 +444,22 @@ private:
 	event_type current_;
 	s_string_pool pool_;
 	validated_set validated_;
+	symbols_table symbols_;
+	std::size_t symbols_count_;
+	symbol_id next_symbol_;
 	std::size_t nesting_;
+	// reusable buffer for characters which can not be referenced in the source
+	byte_buffer text_;
+	// attributes of the start tag read by read_start_element_view
+	const char* attrs_;
+	tag_symbols attrs_names_;
 	char scan_buf_[MAX_SCAN_BUFF_SIZE];
 };
 
+extern template class basic_event_stream_parser<validating_policies>;
+extern template class basic_event_stream_parser<trusted_policies>;
+extern template class basic_event_stream_parser<raw_policies>;
+
 
 
 } // namesapce xml
@@ -0,0 +1,105 @@
+/*
+ *
+ * Copyright (c) 2016-2019
+ * Viktor Gubin
+ *
+ * Use, modification and distribution are subject to the
+ * Boost Software License, Version 1.0. (See accompanying file
+ * LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+#ifndef __IO_XML_PUSH_HPP_INCLUDED__
+#define __IO_XML_PUSH_HPP_INCLUDED__
+
+#include "config.hpp"
+
+#ifdef HAS_PRAGMA_ONCE
+#pragma once
+#endif // HAS_PRAGMA_ONCE
+
+#include "xml_parse.hpp"
+
+namespace io {
+
+namespace xml {
+
+class feed_channel;
+
+class push_parser;
+DECLARE_IPTR(push_parser);
+
+/// \brief Incremental XML parser for the data which arrives by portions, i.e. from a non blocking socket.
+/// Caller feeds bytes as they arrive, and scans parser states as soon as data for them is complete.
+/// Fed bytes are pre-scanned for the markup boundaries, and the underlying event_stream_parser
+/// gets only complete markup and characters, so that partially received tags or multi-byte characters
+/// are kept in the push parser until the rest of them arrives.
+/// Usage:
+/// <pre>
+/// pp->feed(ec, data, size);
+/// while( pp->scan_next(ec) ) {
+///   switch( pp->state() ) ...
+/// }
+/// </pre>
+/// Limitations:
+/// <ul>
+/// <li>Only UTF-8 compatible documents are supported</li>
+/// <li>After #scan_next parser should consume exactly the scanned state i.e. parse an event,
+/// read or skip characters, CDATA, commentary or DTD. event_stream_parser#skip_subtree can not be used</li>
+/// </ul>
+class IO_PUBLIC_SYMBOL push_parser final: public object {
+	push_parser(const push_parser&) = delete;
+	push_parser& operator=(const push_parser&) = delete;
+private:
+	friend class nobadalloc<push_parser>;
+	explicit push_parser(boost::intrusive_ptr<feed_channel>&& ch) noexcept;
+public:
+
+	/// Creates new push parser
+	/// \param ec operation error code, contains error in case of out of memory
+	/// \return new push parser, or empty pointer in case of error
+	/// \throw never throws
+	static s_push_parser create(std::error_code& ec) noexcept;
+
+	virtual ~push_parser() noexcept override;
+
+	/// Appends next portion of document bytes
+	/// \param ec operation error code, contains error in case of out of memory or when document is finished
+	/// \param data document bytes
+	/// \param size count of bytes
+	/// \throw never throws
+	void feed(std::error_code& ec, const void* data, std::size_t size) noexcept;
+
+	/// Marks end of document, so that the rest of fed bytes are parsed even when they are incomplete
+	void finish() noexcept;
+
+	/// Scans next parser state, when all data of it is fed
+	/// \param ec operation error code, contains error when parser can not be created i.e. out of memory
+	///  or not supported character set. Parsing errors are reported by parser
+	/// \return false when more data should be fed, after the end of document or in case of error,
+	///  otherwise true and #parser is moved to the next state
+	/// \throw never throws
+	bool scan_next(std::error_code& ec) noexcept;
+
+	/// Returns parser state scanned by the last successful #scan_next
+	inline state_type state() const noexcept {
+		return state_;
+	}
+
+	/// Returns underlying parser, it is available after the first successful #scan_next
+	/// \return event stream parser
+	inline const s_event_stream_parser& parser() const noexcept {
+		return parser_;
+	}
+
+private:
+	boost::intrusive_ptr<feed_channel> channel_;
+	s_source src_;
+	s_event_stream_parser parser_;
+	state_type state_;
+};
+
+} // namespace xml
+
+} // namespace io
+
+#endif // __IO_XML_PUSH_HPP_INCLUDED__
@@ -0,0 +1,169 @@
+/*
+ *
+ * Copyright (c) 2016-2019
+ * Viktor Gubin
+ *
+ * Use, modification and distribution are subject to the
+ * Boost Software License, Version 1.0. (See accompanying file
+ * LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+#ifndef __IO_XML_QUERY_HPP_INCLUDED__
+#define __IO_XML_QUERY_HPP_INCLUDED__
+
+#include "config.hpp"
+
+#ifdef HAS_PRAGMA_ONCE
+#pragma once
+#endif // HAS_PRAGMA_ONCE
+
+#include "xml_parse.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace io {
+
+namespace xml {
+
+/// Query match callback
+/// \param element matched element, or element owning matched text or attribute
+/// \param value matched text or attribute value, empty for element queries. Valid only inside the callback
+typedef std::function<void(const start_element_event&, const char_view&)> query_callback;
+
+class query_set;
+DECLARE_IPTR(query_set);
+
+/// \brief Set of compiled streaming XPath subset queries, evaluated together in a single pass over a parser.
+/// Supported syntax:
+/// <ul>
+/// <li>Absolute location paths of child / and descendant // steps, i.e. /catalog//book/title </li>
+/// <li>Name tests with optional name space prefix, and * wildcard</li>
+/// <li>Attribute predicates [@id] and [@id='value'] or [@id="value"]</li>
+/// <li>Positional predicates [2] counted from 1 among the siblings which are passing previous predicates,
+///  one per step</li>
+/// <li>Optional last text() step to select element characters, or @name step to select an attribute value</li>
+/// </ul>
+/// Branches which can not match any query are skipped by event_stream_parser#skip_subtree without parsing.
+/// Text of an element is delivered on element end, as concatenation of element own characters and CDATA sections
+class IO_PUBLIC_SYMBOL query_set final: public object {
+	query_set(const query_set&) = delete;
+	query_set& operator=(const query_set&) = delete;
+private:
+	friend class nobadalloc<query_set>;
+
+	enum class predicate_type {
+		attribute_exists,
+		attribute_equals,
+		position
+	};
+
+	struct predicate {
+		predicate_type type;
+		const_string prefix;
+		const_string local_name;
+		const_string value;
+		std::size_t position;
+		symbol_id id;
+	};
+
+	struct step {
+		bool descendant;
+		// empty local name for * wildcard
+		const_string prefix;
+		const_string local_name;
+		symbol_id id;
+		std::vector< predicate, h_allocator<predicate> > predicates;
+	};
+
+	enum class select_type {
+		element,
+		text,
+		attribute
+	};
+
+	struct query {
+		std::vector< step, h_allocator<step> > steps;
+		select_type select;
+		const_string attr_prefix;
+		const_string attr_local_name;
+		symbol_id attr_id;
+		query_callback callback;
+	};
+
+	// query partially matched up to step, by an element or by one of element ancestors for descendant steps
+	struct state {
+		std::size_t query;
+		std::size_t step;
+		// count of children passed predicates before the positional
+		std::size_t count;
+	};
+
+	// element selected by text query, which characters are collected
+	struct collector {
+		start_element_event element;
+		std::vector<char, h_allocator<char> > text;
+		std::vector<std::size_t, h_allocator<std::size_t> > queries;
+	};
+
+	// open element, which child elements are matched
+	struct level {
+		// first state of this level in states stack
+		std::size_t first;
+		// collector index or NO_COLLECTOR
+		std::size_t collector;
+	};
+
+	static constexpr std::size_t NO_COLLECTOR = static_cast<std::size_t>(-1);
+
+	query_set() noexcept;
+
+	static bool compile(std::error_code& ec, const char* path, query& q);
+	bool resolve(const s_event_stream_parser& parser) noexcept;
+	bool matches(const step& st, const start_element_event& ev, std::size_t& count) const noexcept;
+	void push_state(std::size_t first, std::size_t q, std::size_t st);
+	void start_element(const s_event_stream_parser& parser);
+	void end_element(const s_event_stream_parser& parser);
+	void characters(const char_view& chars);
+public:
+
+	/// Creates an empty query set
+	/// \param ec operation error code, contains error in case of out of memory
+	/// \return new query set, or empty pointer in case of error
+	/// \throw never throws
+	static s_query_set create(std::error_code& ec) noexcept;
+
+	virtual ~query_set() noexcept override;
+
+	/// Compiles and adds a query into set
+	/// \param ec operation error code, contains std::errc::invalid_argument when query has syntax error
+	/// \param path query expression, i.e. //book[@lang='en'][1]/title/text()
+	/// \param callback function to call on every match
+	/// \return query index in this set
+	/// \throw never throws
+	std::size_t add(std::error_code& ec, const char* path, const query_callback& callback) noexcept;
+
+	/// Returns count of queries in this set
+	inline std::size_t size() const noexcept {
+		return queries_.size();
+	}
+
+	/// Evaluates all queries over the parser, parser is scanned from the current position until the end of document
+	/// \param ec operation error code, contains parser error or out of memory error
+	/// \param parser XML parser
+	/// \throw never throws, unless callbacks throws
+	void run(std::error_code& ec, const s_event_stream_parser& parser);
+
+private:
+	std::vector< query, h_allocator<query> > queries_;
+	std::vector< state, h_allocator<state> > states_;
+	std::vector< level, h_allocator<level> > levels_;
+	std::vector< collector, h_allocator<collector> > collectors_;
+	std::size_t collectors_used_;
+};
+
+} // namespace xml
+
+} // namespace io
+
+#endif // __IO_XML_QUERY_HPP_INCLUDED__
@@ -45,6 +45,11 @@ public:
 	/// \return end element event
 	end_element_event next_tag_end(std::error_code& ec) noexcept;
 
+	/// Drop parser after the next element end, skipping the element with all nested elements
+	/// without parsing them. Use it to ignore not interesting elements
+	/// \param ec operation error code
+	void skip_element(std::error_code& ec) noexcept;
+
 	/// Checks that start element event points to the specific element name
 	/// \param sev a start element event
 	/// \param nmp a XML name space prefix
@@ -71,6 +76,9 @@ public:
 	/// \param local_name XML element local name
 	/// \return whether start element event points to the specific element name
 	bool is_element(const start_element_event& sev, const char* nmp, const char* local_name) noexcept {
+		const symbol_id id = sev.name().id();
+		if( io_likely( NO_SYMBOL != id ) )
+			return id == parser_->lookup_symbol(nmp, local_name);
 		return is_element(sev, parser_->precache(nmp), parser_->precache(local_name) );
 	}
 
@@ -80,6 +88,9 @@ public:
 	/// \param local_name XML element local name
 	/// \return whether start element event points to the specific element name
 	bool is_element(const end_element_event& eev, const char* nmp, const char* local_name) noexcept {
+		const symbol_id id = eev.name().id();
+		if( io_likely( NO_SYMBOL != id ) )
+			return id == parser_->lookup_symbol(nmp, local_name);
 		return is_element(eev, parser_->precache(nmp), parser_->precache(local_name) );
 	}
 
@@ -99,6 +110,31 @@ public:
 		return is_element(eev, "", local_name );
 	}
 
+	/// Checks that start element event points to the element with specific symbol id
+	/// \param sev a start element event
+	/// \param id symbol id of the element qualified name
+	/// \return whether start element event points to the specific element name
+	bool is_element(const start_element_event& sev, symbol_id id) const noexcept {
+		return id == sev.name().id();
+	}
+
+	/// Checks that end element event points to the element with specific symbol id
+	/// \param eev an end element event
+	/// \param id symbol id of the element qualified name
+	/// \return whether end element event points to the specific element name
+	bool is_element(const end_element_event& eev, symbol_id id) const noexcept {
+		return id == eev.name().id();
+	}
+
+	/// Registers a qualified name with user defined symbol id, see event_stream_parser#register_symbol
+	/// \param id symbol id in [1, FIRST_DYNAMIC_SYMBOL) range
+	/// \param nmp a XML name space prefix
+	/// \param local_name XML element local name
+	/// \return false when id is out of range, name is already registered or out of memory
+	bool register_symbol(symbol_id id, const char* nmp, const char* local_name) noexcept {
+		return parser_->register_symbol(id, nmp, local_name);
+	}
+
 	/// Read current characters e.g tag value
 	/// \param ec operation error code
 	/// \return tag characters
@@ -0,0 +1,150 @@
+/*
+ *
+ * Copyright (c) 2016-2019
+ * Viktor Gubin
+ *
+ * Use, modification and distribution are subject to the
+ * Boost Software License, Version 1.0. (See accompanying file
+ * LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+#ifndef __IO_XML_SAX_HPP_INCLUDED__
+#define __IO_XML_SAX_HPP_INCLUDED__
+
+#include "config.hpp"
+
+#ifdef HAS_PRAGMA_ONCE
+#pragma once
+#endif // HAS_PRAGMA_ONCE
+
+#include "xml_parse.hpp"
+
+namespace io {
+
+namespace xml {
+
+/// \brief SAX like callback front end on top of the event stream parser
+namespace sax {
+
+/// Parses a document and calls handler for each element, attribute and characters.
+/// Handler is a template parameter, so that callbacks are dispatched statically and can be inlined.
+/// Handler should provide:
+/// <ul>
+/// <li><code>void on_start(const char_view& name)</code> element start, name is raw qualified name i.e. prefix:local_name</li>
+/// <li><code>void on_attr(const char_view& name, const char_view& value)</code> attribute of the last started element,
+///  value is normalized and references are decoded</li>
+/// <li><code>void on_end(const char_view& name)</code> element end, called just after attributes for self closed element</li>
+/// <li><code>void on_text(const char_view& text)</code> element characters or CDATA section content, never empty</li>
+/// </ul>
+/// Names and values are transient views, valid only during the callback. Handler decides what to intern or copy.
+/// No start_element_event or strings are built. Prologue, processing instructions, comments and DTD are skipped
+/// \param ec operation error code, contains parsing error or out of memory error when handler throws std::bad_alloc
+/// \param parser parser to parse with, i.e. a parser reused by event_stream_parser#reset
+/// \param handler callbacks handler
+/// \throw never throws
+template<class Policies, class Handler>
+void parse(std::error_code& ec, const boost::intrusive_ptr< basic_event_stream_parser<Policies> >& parser, Handler& handler) noexcept
+{
+	if( io_unlikely(!parser) ) {
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return;
+	}
+#ifndef IO_NO_EXCEPTIONS
+	try {
+#endif // IO_NO_EXCEPTIONS
+		for(state_type state = parser->scan_next(); state_type::eod != state; state = parser->scan_next() ) {
+			switch(state) {
+			case state_type::event:
+				switch( parser->current_event() ) {
+				case event_type::start_document:
+					parser->parse_start_doc();
+					break;
+				case event_type::processing_instruction:
+					parser->parse_processing_instruction();
+					break;
+				case event_type::start_element: {
+					bool empty_element = false;
+					const char_view name = parser->read_start_element_view(empty_element);
+					if( parser->is_error() )
+						break;
+					handler.on_start(name);
+					char_view attr_name, attr_value;
+					while( parser->next_attribute_view(attr_name, attr_value) )
+						handler.on_attr(attr_name, attr_value);
+					if( empty_element && !parser->is_error() )
+						handler.on_end(name);
+				}
+				break;
+				case event_type::end_element: {
+					const char_view name = parser->read_end_element_view();
+					if( !parser->is_error() )
+						handler.on_end(name);
+				}
+				break;
+				}
+				break;
+			case state_type::characters: {
+				const char_view text = parser->read_chars_view();
+				if( !text.empty() )
+					handler.on_text(text);
+			}
+			break;
+			case state_type::cdata: {
+				const char_view text = parser->read_cdata_view();
+				if( !text.empty() )
+					handler.on_text(text);
+			}
+			break;
+			case state_type::comment:
+				parser->skip_comment();
+				break;
+			case state_type::dtd:
+				parser->skip_dtd();
+				break;
+			default:
+				break;
+			}
+		}
+#ifndef IO_NO_EXCEPTIONS
+	} catch(std::bad_alloc&) {
+		ec = std::make_error_code(std::errc::not_enough_memory);
+		return;
+	}
+#endif // IO_NO_EXCEPTIONS
+	if( parser->is_error() )
+		parser->get_last_error(ec);
+}
+
+/// Parses a document from an XML source with the fully validating parser
+/// \param ec operation error code
+/// \param src an XML source
+/// \param handler callbacks handler
+/// \throw never throws
+template<class Handler>
+void parse(std::error_code& ec, s_source&& src, Handler& handler) noexcept
+{
+	s_event_stream_parser parser = event_stream_parser::open(ec, std::forward<s_source>(src) );
+	if(!ec)
+		parse(ec, parser, handler);
+}
+
+/// Parses a document from a read channel with the fully validating parser
+/// \param ec operation error code
+/// \param src document source channel
+/// \param handler callbacks handler
+/// \throw never throws
+template<class Handler>
+void parse(std::error_code& ec, s_read_channel&& src, Handler& handler) noexcept
+{
+	s_event_stream_parser parser = event_stream_parser::open(ec, std::forward<s_read_channel>(src) );
+	if(!ec)
+		parse(ec, parser, handler);
+}
+
+} // namespace sax
+
+} // namespace xml
+
+} // namespace io
+
+#endif // __IO_XML_SAX_HPP_INCLUDED__
@@ -22,10 +22,78 @@
 #include "text.hpp"
 #include "charsetdetector.hpp"
 
+#ifdef __HAS_CPP_17
+#	include <string_view>
+#endif // __HAS_CPP_17
+
 namespace io {
 
 namespace xml {
 
+/// \brief Read only view on characters, references memory owned by a source or parser
+/// View is valid until the next call of the owner
+class char_view {
+public:
+	constexpr char_view() noexcept:
+		begin_(nullptr),
+		end_(nullptr)
+	{}
+	constexpr char_view(const char* begin, const char* end) noexcept:
+		begin_(begin),
+		end_(end)
+	{}
+	constexpr char_view(const char* str, std::size_t size) noexcept:
+		begin_(str),
+		end_(str + size)
+	{}
+	/// Returns address of the first character
+	inline const char* data() const noexcept {
+		return begin_;
+	}
+	/// Returns address of the first character
+	inline const char* begin() const noexcept {
+		return begin_;
+	}
+	/// Returns address after the last character
+	inline const char* end() const noexcept {
+		return end_;
+	}
+	/// Returns view size in bytes
+	inline std::size_t size() const noexcept {
+		return memory_traits::distance(begin_, end_);
+	}
+	/// Checks whether this view contains no characters
+	inline bool empty() const noexcept {
+		return begin_ == end_;
+	}
+#ifdef __HAS_CPP_17
+	/// Returns STD string view on the same characters
+	inline std::string_view get_view() const noexcept {
+		return std::string_view( begin_, size() );
+	}
+#endif // __HAS_CPP_17
+private:
+	const char* begin_;
+	const char* end_;
+};
+
+/// \brief XML source memory limits
+struct source_limits {
+	/// Read buffer window size, buffer is refilled by the window after the consumed data
+	std::size_t window;
+	/// Maximal size of the read buffer or a single token buffer, window is grown up to this size
+	/// only when a token does not fit into it
+	std::size_t memory;
+};
+
+/// Default read window size
+constexpr std::size_t DEFAULT_SOURCE_WINDOW = 0x10000; // 64k
+/// Default maximal memory per source buffer
+constexpr std::size_t DEFAULT_SOURCE_MEMORY = 0x1000000; // 16m
+
+/// Default XML source memory limits
+constexpr source_limits DEFAULT_SOURCE_LIMITS = { DEFAULT_SOURCE_WINDOW, DEFAULT_SOURCE_MEMORY };
+
 class source;
 
 DECLARE_IPTR(source);
@@ -40,7 +108,16 @@ public:
 	/// \param ec operation error code
 	/// \param src source byte channel
 	/// \return smart pointer source reference when no error code, otherwise an empty smart pointer
-    static s_source create(std::error_code& ec,s_read_channel&& src) noexcept;
+    static s_source create(std::error_code& ec,s_read_channel&& src) noexcept {
+        return create(ec, std::forward<s_read_channel>(src), DEFAULT_SOURCE_LIMITS);
+    }
+
+	/// Create new XML source from a readable byte channel, with custom memory limits
+	/// \param ec operation error code
+	/// \param src source byte channel
+	/// \param limits read window size and maximal memory per buffer
+	/// \return smart pointer source reference when no error code, otherwise an empty smart pointer
+    static s_source create(std::error_code& ec,s_read_channel&& src,const source_limits& limits) noexcept;
 
 	/// Create new XML source from a readable byte channel
 	/// \param ec operation error code
@@ -50,9 +127,52 @@ public:
         return create(ec, s_read_channel(src) );
     }
 
+	/// Create new XML source from a view read channel, like memory mapped file.
+	/// UTF-8 and latin1 documents are scanned in place without copying into internal buffer,
+	/// other UNICODE documents are transcoded the same way as for regular read channel.
+	/// Slow channels i.e. network file systems can be decorated by read_ahead_channel,
+	/// so that next data blocks are read while parser scans the current one
+	/// \param ec operation error code
+	/// \param src source view channel
+	/// \return smart pointer source reference when no error code, otherwise an empty smart pointer
+    static s_source create(std::error_code& ec,s_view_read_channel&& src) noexcept {
+        return create(ec, std::forward<s_view_read_channel>(src), DEFAULT_SOURCE_LIMITS);
+    }
+
+	/// Create new XML source from a view read channel with custom memory limits,
+	/// window size is used only when document is transcoded
+	/// \param ec operation error code
+	/// \param src source view channel
+	/// \param limits read window size and maximal memory per buffer
+	/// \return smart pointer source reference when no error code, otherwise an empty smart pointer
+    static s_source create(std::error_code& ec,s_view_read_channel&& src,const source_limits& limits) noexcept;
+
+	/// Create new XML source from a view read channel, like memory mapped file.
+	/// \param ec operation error code
+	/// \param src source view channel
+	/// \return smart pointer source reference when no error code, otherwise an empty smart pointer
+    static s_source create(std::error_code& ec,const s_view_read_channel& src) noexcept {
+        return create(ec, s_view_read_channel(src) );
+    }
+
     /// Releases internally allocated resources
     virtual ~source() noexcept override;
 
+    /// Returns source memory limits
+    inline const source_limits& limits() const noexcept {
+        return limits_;
+    }
+
+    /// Resets source to the beginning of a next document, read buffer and character set detector are reused
+    /// \param ec operation error code, source is not usable after an error until next successful reset
+    /// \param src next document byte channel
+    void reset(std::error_code& ec,s_read_channel&& src) noexcept;
+
+    /// Resets source to the beginning of a next document from a view read channel, like memory mapped file.
+    /// \param ec operation error code, source is not usable after an error until next successful reset
+    /// \param src next document view channel
+    void reset(std::error_code& ec,s_view_read_channel&& src) noexcept;
+
     /// Returns next character or character component byte
     char next() noexcept;
 
@@ -67,21 +187,62 @@ public:
     /// \param ch double characters to lookup, i.e. -- or ]]
     void read_until_double_char(byte_buffer& to, const char ch) noexcept;
 
+    /// Reads characters until a legal or illegal characters in the stream, or EOF.
+    /// Characters are referenced in place when they are contiguous in the read buffer and
+    /// don't need line endings normalization, otherwise they are copied into the buffer.
+    /// Stop character is consumed, but not included into the result
+    /// \param to byte buffer to copy characters into, when not empty characters are appended to it's content
+    /// \param ch stop character
+    /// \param illegal an illegal character in the may occur in the stream
+    /// \return view on characters, valid until next source call. Check #last_error for failure
+    char_view read_view_until_char(byte_buffer& to,const char ch,const char illegal) noexcept;
+
+    /// Reads characters until a double characters in the stream, or EOF.
+    /// Characters are referenced in place when they are contiguous in the read buffer and
+    /// don't need line endings normalization, otherwise they are copied into the buffer.
+    /// Double characters are consumed, but not included into the result
+    /// \param to byte buffer to copy characters into, must be empty
+    /// \param ch double characters to lookup, i.e. -- or ]]
+    /// \return view on characters, valid until next source call. Check #last_error for failure
+    char_view read_view_until_double_char(byte_buffer& to, const char ch) noexcept;
+
+    /// Skips characters until one of the stop characters or EOF, without copying them.
+    /// Runs of characters without stop characters are skipped by blocks
+    /// \param c1 stop character
+    /// \param c2 stop character
+    /// \param c3 stop character
+    /// \param c4 stop character
+    /// \return consumed stop character, or EOF. Check #last_error for failure
+    char skip_until(const char c1, const char c2, const char c3, const char c4) noexcept;
+
+    /// Returns next byte without consuming it
+    /// \return next byte or EOF
+    char peek() noexcept;
+
     /// Checks current state is end of stream
     /// \return whether end of stream
     inline bool eof() const noexcept {
-        return error::ok != last_ && pos_ != end_;
+        return error::ok != last_ || pos_ == end_;
     }
 
-    /// Current XML source character row
-    inline std::size_t row() const noexcept {
-        return row_;
+    /// Returns count of bytes already read from the channel, but not consumed yet
+    inline std::size_t buffered() const noexcept {
+        return pos_ < end_ ? memory_traits::distance(pos_, end_) - 1 : 0;
     }
 
-    /// Current XML source character column
-    inline std::size_t col() const noexcept {
-        return col_;
-    }
+    /// Skips XML white space characters, without copying them
+    /// \return next non white space character which is not consumed, or EOF
+    char skip_spaces() noexcept;
+
+    /// Current XML source character row, rows are counted lazily on demand
+    std::size_t row() const noexcept;
+
+    /// Current XML source character column, columns are counted lazily on demand
+    std::size_t col() const noexcept;
+
+    /// Current XML source byte offset, i.e. count of consumed UTF-8 bytes.
+    /// Offset is in the UTF-8 text the source exposes, which is transcoded for other UNICODE documents
+    std::size_t position() const noexcept;
 
 	/// Returns last operation error
 	/// \return last operation error
@@ -90,23 +251,44 @@ public:
     }
 private:
     static const std::size_t READ_BUFF_INITIAL_SIZE;
-    static const std::size_t READ_BUFF_MAXIMAL_SIZE;
-    static s_source open(std::error_code& ec, const s_read_channel& src, byte_buffer&& rb) noexcept;
+    static s_source open(std::error_code& ec, const s_read_channel& src, byte_buffer&& rb, const source_limits& limits) noexcept;
     friend io::nobadalloc<source>;
-    source(s_read_channel&& src, byte_buffer&& rb) noexcept;
+    source(s_read_channel&& src, byte_buffer&& rb, const source_limits& limits) noexcept;
+    source(s_view_read_channel&& src, const read_view& v, const source_limits& limits) noexcept;
+    inline void set_view(const read_view& v) noexcept;
+    const s_charset_detector& detector(std::error_code& ec) noexcept;
+    void rewind() noexcept;
     error read_more() noexcept;
+    bool slide() noexcept;
     error charge() noexcept;
+    error stitch() noexcept;
+    error validate() noexcept;
+    inline bool valid_to(const char* e) noexcept;
+    bool grow(byte_buffer& to, std::size_t required) noexcept;
     inline bool fetch() noexcept;
     inline char normalize_line_endings(const char ch);
+    void count_position(const char* e) const noexcept;
+    inline const char* consumed() const noexcept;
+    inline bool put_run(byte_buffer& to, const char* stop) noexcept;
 private:
     error last_;
     const char *pos_;
     const char *end_;
-    std::size_t row_;
-    std::size_t col_;
+    // position of base_
+    mutable std::size_t row_;
+    mutable std::size_t col_;
     s_read_channel src_;
     byte_buffer rb_;
-    uint8_t mb_state_;
+    s_view_read_channel vsrc_;
+    // end of validated UTF-8 characters in the current data block
+    const char* valid_;
+    // character cut by the end of a channel view, joined with the next view bytes
+    char stitch_[8];
+    s_charset_detector chdet_;
+    // start of the consumed characters which are not counted yet into row and column
+    mutable const char* base_;
+    mutable std::size_t offset_;
+    source_limits limits_;
 };
 
 } // namespace xml
@@ -0,0 +1,308 @@
+/*
+ *
+ * Copyright (c) 2016-2019
+ * Viktor Gubin
+ *
+ * Use, modification and distribution are subject to the
+ * Boost Software License, Version 1.0. (See accompanying file
+ * LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+#include "stdafx.hpp"
+#include "buffered_channel.hpp"
+
+namespace io {
+
+static inline scoped_arr<uint8_t> new_channel_buffer(std::error_code& ec, std::size_t size) noexcept
+{
+	scoped_arr<uint8_t> ret( 0 == size ? memory_traits::page_size() : size );
+	if( !ret )
+		ec = std::make_error_code(std::errc::not_enough_memory);
+	return ret;
+}
+
+// buffered_read_channel
+s_view_read_channel buffered_read_channel::open(std::error_code& ec, const s_read_channel& src, std::size_t buffer_size) noexcept
+{
+	if( io_unlikely(!src) ) {
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return s_view_read_channel();
+	}
+	scoped_arr<uint8_t> buff = new_channel_buffer(ec, buffer_size);
+	if(ec)
+		return s_view_read_channel();
+	buffered_read_channel *ret = nobadalloc<buffered_read_channel>::construct(ec, src, std::move(buff) );
+	return io_likely(nullptr != ret) ? s_view_read_channel(ret) : s_view_read_channel();
+}
+
+buffered_read_channel::buffered_read_channel(const s_read_channel& src, scoped_arr<uint8_t>&& buff) noexcept:
+	view_read_channel(),
+	src_(src),
+	buff_( std::forward< scoped_arr<uint8_t> >(buff) ),
+	pos_(0),
+	end_(0)
+{}
+
+buffered_read_channel::~buffered_read_channel() noexcept
+{}
+
+read_view buffered_read_channel::fill(std::error_code& ec) const noexcept
+{
+	if(pos_ == end_) {
+		pos_ = 0;
+		end_ = src_->read(ec, buff_.get(), buff_.len() );
+		if(ec)
+			end_ = 0;
+	}
+	return read_view( buff_.get() + pos_, buff_.get() + end_ );
+}
+
+void buffered_read_channel::consume(std::size_t bytes) const noexcept
+{
+	pos_ += bytes;
+	if(pos_ > end_)
+		pos_ = end_;
+}
+
+std::size_t buffered_read_channel::read(std::error_code& ec,uint8_t* const buff, std::size_t bytes) const noexcept
+{
+	// large reads with empty buffer goes directly to the source
+	if(pos_ == end_ && bytes >= buff_.len() )
+		return src_->read(ec, buff, bytes);
+	read_view v = fill(ec);
+	std::size_t ret = v.size() < bytes ? v.size() : bytes;
+	if(ret > 0) {
+		io_memmove(buff, v.begin(), ret);
+		pos_ += ret;
+	}
+	return ret;
+}
+
+// read_ahead_channel
+s_view_read_channel read_ahead_channel::open(std::error_code& ec, const s_read_channel& src, std::size_t block_size, std::size_t blocks) noexcept
+{
+	if( io_unlikely(!src) ) {
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return s_view_read_channel();
+	}
+	if(0 == block_size)
+		block_size = DEFAULT_BLOCK_SIZE;
+	if(blocks < 2)
+		blocks = DEFAULT_BLOCKS;
+	scoped_arr<uint8_t> buff = new_channel_buffer(ec, block_size * blocks);
+	if(ec)
+		return s_view_read_channel();
+	scoped_arr<std::size_t> sizes(blocks);
+	if( !sizes ) {
+		ec = std::make_error_code(std::errc::not_enough_memory);
+		return s_view_read_channel();
+	}
+	read_ahead_channel *ch = nobadalloc<read_ahead_channel>::construct(ec, src, std::move(buff), std::move(sizes), block_size );
+	if(ec)
+		return s_view_read_channel();
+	s_view_read_channel ret(ch);
+	return ch->start(ec) ? ret : s_view_read_channel();
+}
+
+read_ahead_channel::read_ahead_channel(const s_read_channel& src, scoped_arr<uint8_t>&& buff, scoped_arr<std::size_t>&& sizes, std::size_t block_size) noexcept:
+	view_read_channel(),
+	src_(src),
+	buff_( std::forward< scoped_arr<uint8_t> >(buff) ),
+	sizes_( std::forward< scoped_arr<std::size_t> >(sizes) ),
+	block_size_(block_size),
+	filled_(0),
+	released_(0),
+	pos_(0),
+	ec_(),
+	stop_(false),
+	consumer_waits_(false),
+	producer_waits_(false),
+	mtx_(),
+	cv_(),
+	worker_()
+{}
+
+read_ahead_channel::~read_ahead_channel() noexcept
+{
+	if( worker_.joinable() ) {
+		stop_ = true;
+		{
+			std::lock_guard<std::mutex> lock(mtx_);
+			cv_.notify_all();
+		}
+		worker_.join();
+	}
+}
+
+bool read_ahead_channel::start(std::error_code& ec) noexcept
+{
+#ifndef IO_NO_EXCEPTIONS
+	try {
+#endif // IO_NO_EXCEPTIONS
+		worker_ = std::thread( &read_ahead_channel::run, this );
+#ifndef IO_NO_EXCEPTIONS
+	} catch(std::system_error& exc) {
+		ec = exc.code();
+		return false;
+	}
+#else
+	// thread creation failure terminates without exceptions
+	static_cast<void>(ec);
+#endif // IO_NO_EXCEPTIONS
+	return true;
+}
+
+// blocks until the background thread releases ring slot of the block, returns false when channel is closing
+bool read_ahead_channel::wait_released(std::size_t block) noexcept
+{
+	const std::size_t blocks = sizes_.len();
+	if( io_likely( (released_ + blocks) > block ) )
+		return !stop_;
+	std::unique_lock<std::mutex> lock(mtx_);
+	producer_waits_ = true;
+	cv_.wait(lock, [this, block, blocks] () noexcept { return stop_ || (released_ + blocks) > block; } );
+	producer_waits_ = false;
+	return !stop_;
+}
+
+// blocks until the background thread fills the block
+void read_ahead_channel::wait_filled(std::size_t block) const noexcept
+{
+	if( io_likely( filled_ > block ) )
+		return;
+	std::unique_lock<std::mutex> lock(mtx_);
+	consumer_waits_ = true;
+	cv_.wait(lock, [this, block] () noexcept { return filled_ > block; } );
+	consumer_waits_ = false;
+}
+
+void read_ahead_channel::run() noexcept
+{
+	const std::size_t blocks = sizes_.len();
+	for(std::size_t block = 0; wait_released(block); block++) {
+		const std::size_t slot = block % blocks;
+		std::error_code ec;
+		std::size_t read = src_->read(ec, buff_.get() + (slot * block_size_), block_size_);
+		if(ec) {
+			ec_ = ec;
+			read = 0;
+		}
+		sizes_[slot] = read;
+		// publish filled block, waiting flag is checked after the publishing so that consumer can not miss it
+		filled_ = block + 1;
+		if( consumer_waits_ ) {
+			std::lock_guard<std::mutex> lock(mtx_);
+			cv_.notify_all();
+		}
+		if(0 == read)
+			break;
+	}
+}
+
+read_view read_ahead_channel::fill(std::error_code& ec) const noexcept
+{
+	const std::size_t blocks = sizes_.len();
+	std::size_t block = released_.load(std::memory_order_relaxed);
+	wait_filled(block);
+	std::size_t size = sizes_[block % blocks];
+	// previous view was consumed, it is valid until this call so the block is released only now
+	if( pos_ == size && 0 != size ) {
+		pos_ = 0;
+		released_ = ++block;
+		if( producer_waits_ ) {
+			std::lock_guard<std::mutex> lock(mtx_);
+			cv_.notify_all();
+		}
+		wait_filled(block);
+		size = sizes_[block % blocks];
+	}
+	// end of data
+	if(0 == size) {
+		if(ec_)
+			ec = ec_;
+		return read_view();
+	}
+	const uint8_t* b = buff_.get() + ( (block % blocks) * block_size_ );
+	return read_view( b + pos_, b + size );
+}
+
+void read_ahead_channel::consume(std::size_t bytes) const noexcept
+{
+	const std::size_t size = sizes_[released_.load(std::memory_order_relaxed) % sizes_.len()];
+	pos_ += bytes;
+	if(pos_ > size)
+		pos_ = size;
+}
+
+std::size_t read_ahead_channel::read(std::error_code& ec,uint8_t* const buff, std::size_t bytes) const noexcept
+{
+	read_view v = fill(ec);
+	std::size_t ret = v.size() < bytes ? v.size() : bytes;
+	if(ret > 0) {
+		io_memmove(buff, v.begin(), ret);
+		pos_ += ret;
+	}
+	return ret;
+}
+
+// buffered_write_channel
+s_write_channel buffered_write_channel::open(std::error_code& ec, const s_write_channel& dst, std::size_t buffer_size) noexcept
+{
+	if( io_unlikely(!dst) ) {
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return s_write_channel();
+	}
+	scoped_arr<uint8_t> buff = new_channel_buffer(ec, buffer_size);
+	if(ec)
+		return s_write_channel();
+	buffered_write_channel *ret = nobadalloc<buffered_write_channel>::construct(ec, dst, std::move(buff) );
+	return io_likely(nullptr != ret) ? s_write_channel(ret) : s_write_channel();
+}
+
+buffered_write_channel::buffered_write_channel(const s_write_channel& dst, scoped_arr<uint8_t>&& buff) noexcept:
+	write_channel(),
+	dst_(dst),
+	buff_( std::forward< scoped_arr<uint8_t> >(buff) ),
+	pos_(0)
+{}
+
+buffered_write_channel::~buffered_write_channel() noexcept
+{
+	std::error_code ec;
+	drain(ec);
+}
+
+// on write error not written tail is kept in the buffer, so that next flush can retry it
+void buffered_write_channel::drain(std::error_code& ec) const noexcept
+{
+	if(pos_ > 0) {
+		const std::size_t written = transmit_buffer(ec, dst_, buff_.get(), pos_);
+		if( io_unlikely(written < pos_) )
+			io_memmove(buff_.get(), buff_.get() + written, pos_ - written);
+		pos_ -= written;
+	}
+}
+
+std::size_t buffered_write_channel::write(std::error_code& ec, const uint8_t* buff,std::size_t size) const noexcept
+{
+	if( size > (buff_.len() - pos_) ) {
+		drain(ec);
+		if(ec)
+			return 0;
+		// block larger then buffer goes directly to the destination
+		if( size >= buff_.len() )
+			return dst_->write(ec, buff, size);
+	}
+	io_memmove(buff_.get() + pos_, buff, size);
+	pos_ += size;
+	return size;
+}
+
+void buffered_write_channel::flush(std::error_code& ec) const noexcept
+{
+	drain(ec);
+	if(!ec)
+		dst_->flush(ec);
+}
+
+} // namespace io
@@ -11,6 +11,10 @@
 #include "stdafx.hpp"
 #include "channels.hpp"
 
+#ifdef __IO_POSIX_BACKEND__
+#	include "posix/files.hpp"
+#endif // __IO_POSIX_BACKEND__
+
 namespace io {
 
 //read_channel
@@ -18,11 +22,57 @@ read_channel::read_channel() noexcept:
 	channel()
 {}
 
+std::size_t read_channel::readv(std::error_code& ec, const read_segment* segments, std::size_t count) const noexcept
+{
+	std::size_t ret = 0;
+	for(std::size_t i = 0; i < count; i++) {
+		std::size_t read = this->read(ec, segments[i].data, segments[i].size);
+		ret += read;
+		if( ec || read < segments[i].size )
+			break;
+	}
+	return ret;
+}
+
+// view_read_channel
+view_read_channel::view_read_channel() noexcept:
+	read_channel()
+{}
+
 //write_channel
 write_channel::write_channel() noexcept:
 	channel()
 {}
 
+void write_channel::flush(std::error_code&) const noexcept
+{}
+
+std::size_t write_channel::writev(std::error_code& ec, const write_segment* segments, std::size_t count) const noexcept
+{
+	// join small requests to issue a single write
+	static constexpr std::size_t MAX_JOIN_SIZE = 4096;
+	std::size_t total = 0;
+	for(std::size_t i = 0; i < count; i++)
+		total += segments[i].size;
+	if( total <= MAX_JOIN_SIZE ) {
+		uint8_t tmp[MAX_JOIN_SIZE];
+		uint8_t *pos = tmp;
+		for(std::size_t i = 0; i < count; i++) {
+			io_memmove(pos, segments[i].data, segments[i].size);
+			pos += segments[i].size;
+		}
+		return write(ec, tmp, total);
+	}
+	std::size_t ret = 0;
+	for(std::size_t i = 0; i < count; i++) {
+		std::size_t written = write(ec, segments[i].data, segments[i].size);
+		ret += written;
+		if( ec || written < segments[i].size )
+			break;
+	}
+	return ret;
+}
+
 // read_write_channel
 read_write_channel::read_write_channel() noexcept:
 	channel(),
@@ -109,6 +159,40 @@ std::size_t IO_PUBLIC_SYMBOL transmit_buffer(std::error_code& ec,
 	return ret;
 }
 
+std::size_t IO_PUBLIC_SYMBOL transmit_buffers(std::error_code& ec,
+				const s_write_channel& ch,
+				const write_segment* segments, std::size_t count) noexcept
+{
+	if( io_unlikely( !ch || nullptr == segments || 0 == count) ) {
+		ec = std::make_error_code( std::errc::invalid_argument );
+		return 0;
+	}
+	// working copy, to adjust partially written segments
+	scoped_arr<write_segment> tmp(count);
+	if( !tmp ) {
+		ec = std::make_error_code(std::errc::not_enough_memory);
+		return 0;
+	}
+	std::copy(segments, segments + count, tmp.get() );
+	write_segment *b = tmp.get();
+	write_segment *e = b + count;
+	std::size_t ret = 0;
+	std::size_t written;
+	do {
+		written = ch->writev(ec, b, memory_traits::distance(b,e) );
+		ret += written;
+		while( b < e && written >= b->size ) {
+			written -= b->size;
+			++b;
+		}
+		if( b < e ) {
+			b->data += written;
+			b->size -= written;
+		}
+	} while( (b < e) && !ec);
+	return ret;
+}
+
 std::size_t IO_PUBLIC_SYMBOL transmit(std::error_code& ec,const s_read_channel& src, const s_write_channel& dst, unsigned long buff_size) noexcept
 {
 	if( io_unlikely(!src || !dst || buff_size < 2 ) )  {
@@ -116,6 +200,16 @@ std::size_t IO_PUBLIC_SYMBOL transmit(std::error_code& ec,const s_read_channel&
 		return 0;
 	}
 
+#ifdef __IO_POSIX_BACKEND__
+	const intptr_t src_fd = src->native_handle();
+	const intptr_t dst_fd = dst->native_handle();
+	if( -1 != src_fd && -1 != dst_fd ) {
+		std::size_t transfered = 0;
+		if( posix::kernel_transmit(ec, static_cast<posix::fd_t>(src_fd), static_cast<posix::fd_t>(dst_fd), transfered) )
+			return transfered;
+	}
+#endif // __IO_POSIX_BACKEND__
+
 	static constexpr std::size_t al = (sizeof(std::size_t) * 2) - 1;
 	static constexpr std::size_t rm = ~al;
 
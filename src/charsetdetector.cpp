@@ -670,7 +670,7 @@ charset_detect_status charset_detector::detect(std::error_code &ec,const uint8_t
 	case unicode_cp::utf_32be:
 		return charset_detect_status(code_pages::UTF_32BE, 1.0f);
 	case unicode_cp::utf_32le:
-		return charset_detect_status(code_pages::UTF_32BE, 1.0f);
+		return charset_detect_status(code_pages::UTF_32LE, 1.0f);
 	}
 	// no unicode byte order mark found, try to detect/guess by evristic
 	// algorythms
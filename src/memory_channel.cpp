@@ -20,7 +20,7 @@ s_read_channel memory_read_channel::open(std::error_code& ec, byte_buffer&& buff
 }
 
 memory_read_channel::memory_read_channel(byte_buffer&& data) noexcept:
-	read_channel(),
+	view_read_channel(),
 	data_( std::forward<byte_buffer>(data) ),
 	mtx_()
 {}
@@ -40,6 +40,21 @@ std::size_t memory_read_channel::read(std::error_code& ec,uint8_t* const buff, s
 	return ret;
 }
 
+read_view memory_read_channel::fill(std::error_code&) const noexcept
+{
+	if( data_.empty() )
+		return read_view();
+	lock_guard lock(mtx_);
+	const uint8_t* begin = data_.position().get();
+	return read_view( begin, begin + data_.length() );
+}
+
+void memory_read_channel::consume(std::size_t bytes) const noexcept
+{
+	lock_guard lock(mtx_);
+	data_.shift(bytes);
+}
+
 // memory_write_channel
 
 s_memory_write_channel memory_write_channel::open(std::error_code& ec, std::size_t initial_size) noexcept
@@ -11,7 +11,7 @@
 #include "stdafx.hpp"
 #include "http_client.hpp"
 
-#include <sstream>
+#include <vector>
 
 namespace io {
 
@@ -32,23 +32,30 @@ request::request(request_method method, const s_uri& uri) noexcept:
 
 void request::send(std::error_code& ec, const s_write_channel& to) const
 {
-	std::stringstream buff;
+	// gather request head from it's parts, without joining them into a string
+	std::vector<write_segment> segments;
+	segments.reserve( 6 + (hdrs_.size() * 4) );
+	auto append = [&segments] (const char* str, std::size_t size) {
+		segments.push_back( write_segment{ str_bytes(str), size } );
+	};
 	switch(method_) {
 		case request_method::get:
 		default:
-			buff << "GET ";
+			append("GET ", 4);
 			break;
 	}
-	buff << uri_->path();
-	buff << " HTTP/1.1\r\n";
-	buff << "Host: " << uri_->host() << "\r\n";
-	for(auto hdr: hdrs_) {
-		buff << hdr.name() << ": ";
-		buff << hdr.value() << "\r\n";
+	append( uri_->path().data(), uri_->path().size() );
+	append( " HTTP/1.1\r\nHost: ", 17);
+	append( uri_->host().data(), uri_->host().size() );
+	append( "\r\n", 2);
+	for(const header& hdr: hdrs_) {
+		append( hdr.name().data(), hdr.name().size() );
+		append( ": ", 2);
+		append( hdr.value().data(), hdr.value().size() );
+		append( "\r\n", 2);
 	}
-	buff << "\r\n";
-	std::string tmp = buff.str();
-	to->write(ec, str_bytes( tmp.data() ), tmp.size() );
+	append( "\r\n", 2);
+	transmit_buffers(ec, to, segments.data(), segments.size() );
 }
 
 // FIXME: refactor to factory
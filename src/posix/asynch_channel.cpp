@@ -0,0 +1,462 @@
+/*
+ *
+ * Copyright (c) 2016-2019
+ * Viktor Gubin
+ *
+ * Use, modification and distribution are subject to the
+ * Boost Software License, Version 1.0. (See accompanying file
+ * LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+#include "stdafx.hpp"
+
+#ifdef __linux__
+
+#include "asynch_channel.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <linux/io_uring.h>
+
+namespace io {
+
+// glibc have no io_uring wrappers, use raw system calls
+static inline int io_uring_setup_syscall(unsigned int entries, ::io_uring_params* p) noexcept
+{
+	return static_cast<int>( ::syscall(__NR_io_uring_setup, entries, p) );
+}
+
+static inline int io_uring_enter_syscall(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags) noexcept
+{
+	return static_cast<int>( ::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0) );
+}
+
+static inline unsigned int load_acquire(const unsigned int* p) noexcept
+{
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void store_release(unsigned int* p, unsigned int v) noexcept
+{
+	__atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+static inline void prepare_rw(::io_uring_sqe* sqe, uint8_t opcode, int fd, const void* addr, std::size_t len, uint64_t offset, uint64_t user_data) noexcept
+{
+	std::memset(sqe, 0, sizeof(::io_uring_sqe) );
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->addr = reinterpret_cast<uint64_t>(addr);
+	sqe->len = static_cast<uint32_t>(len);
+	sqe->off = offset;
+	sqe->user_data = user_data;
+}
+
+// operations with this user data are cancel requests, and their completions are skipped
+static constexpr uint64_t CANCEL_USER_DATA = 0;
+// use current file position for non seekable descriptors
+static constexpr uint64_t CURRENT_POSITION = static_cast<uint64_t>(-1);
+
+// asynch_io_service
+struct asynch_io_service::operation {
+	operation* next;
+	boost::intrusive_ptr<posix::asynch_channel> ch;
+	byte_buffer buff;
+	uint8_t opcode;
+	std::size_t pos;
+	std::size_t done;
+};
+
+asynch_io_service::asynch_io_service(unsigned int queue_depth) noexcept:
+	object(),
+	queue_depth_(queue_depth),
+	ring_fd_(-1),
+	sq_ring_(nullptr),
+	sq_ring_size_(0),
+	sq_head_(nullptr),
+	sq_tail_(nullptr),
+	sq_mask_(nullptr),
+	sq_array_(nullptr),
+	sq_entries_(0),
+	sqes_(nullptr),
+	cq_ring_(nullptr),
+	cq_ring_size_(0),
+	cq_head_(nullptr),
+	cq_tail_(nullptr),
+	cq_mask_(nullptr),
+	cqes_(nullptr),
+	ops_(nullptr),
+	free_ops_(nullptr),
+	to_submit_(0),
+	in_flight_(0)
+{}
+
+asynch_io_service::~asynch_io_service() noexcept
+{
+	if(nullptr != sqes_)
+		::munmap(sqes_, sq_entries_ * sizeof(::io_uring_sqe) );
+	if(nullptr != cq_ring_ && cq_ring_ != sq_ring_)
+		::munmap(cq_ring_, cq_ring_size_);
+	if(nullptr != sq_ring_)
+		::munmap(sq_ring_, sq_ring_size_);
+	if(-1 != ring_fd_)
+		::close(ring_fd_);
+	delete [] ops_;
+}
+
+bool asynch_io_service::start(std::error_code& ec) noexcept
+{
+	::io_uring_params p;
+	std::memset(&p, 0, sizeof(p) );
+	ring_fd_ = io_uring_setup_syscall(queue_depth_, &p);
+	if(-1 == ring_fd_) {
+		ec.assign(errno, std::system_category() );
+		return false;
+	}
+	sq_entries_ = p.sq_entries;
+	sq_ring_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	cq_ring_size_ = p.cq_off.cqes + p.cq_entries * sizeof(::io_uring_cqe);
+	const bool single_mmap = 0 != (p.features & IORING_FEAT_SINGLE_MMAP);
+	if(single_mmap && cq_ring_size_ > sq_ring_size_)
+		sq_ring_size_ = cq_ring_size_;
+	void *px = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+	if(MAP_FAILED == px) {
+		ec.assign(errno, std::system_category() );
+		return false;
+	}
+	sq_ring_ = static_cast<uint8_t*>(px);
+	if(single_mmap) {
+		cq_ring_ = sq_ring_;
+	} else {
+		px = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+		if(MAP_FAILED == px) {
+			ec.assign(errno, std::system_category() );
+			return false;
+		}
+		cq_ring_ = static_cast<uint8_t*>(px);
+	}
+	px = ::mmap(nullptr, sq_entries_ * sizeof(::io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+	if(MAP_FAILED == px) {
+		ec.assign(errno, std::system_category() );
+		return false;
+	}
+	sqes_ = static_cast<::io_uring_sqe*>(px);
+
+	sq_head_ = reinterpret_cast<unsigned int*>(sq_ring_ + p.sq_off.head);
+	sq_tail_ = reinterpret_cast<unsigned int*>(sq_ring_ + p.sq_off.tail);
+	sq_mask_ = reinterpret_cast<unsigned int*>(sq_ring_ + p.sq_off.ring_mask);
+	sq_array_ = reinterpret_cast<unsigned int*>(sq_ring_ + p.sq_off.array);
+	cq_head_ = reinterpret_cast<unsigned int*>(cq_ring_ + p.cq_off.head);
+	cq_tail_ = reinterpret_cast<unsigned int*>(cq_ring_ + p.cq_off.tail);
+	cq_mask_ = reinterpret_cast<unsigned int*>(cq_ring_ + p.cq_off.ring_mask);
+	cqes_ = reinterpret_cast<::io_uring_cqe*>(cq_ring_ + p.cq_off.cqes);
+
+	ops_ = new (std::nothrow) operation[queue_depth_];
+	if(nullptr == ops_) {
+		ec = std::make_error_code(std::errc::not_enough_memory);
+		return false;
+	}
+	for(unsigned int i = 0; i < queue_depth_; i++)
+		ops_[i].next = (i + 1 < queue_depth_) ? &ops_[i+1] : nullptr;
+	free_ops_ = ops_;
+	return true;
+}
+
+s_asynch_io_service asynch_io_service::create(std::error_code& ec, unsigned int queue_depth) noexcept
+{
+	if( io_unlikely(0 == queue_depth || queue_depth > UINT16_MAX) ) {
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return s_asynch_io_service();
+	}
+	s_asynch_io_service ret( nobadalloc<asynch_io_service>::construct(ec, queue_depth) );
+	if( ret && !ret->start(ec) )
+		return s_asynch_io_service();
+	return ret;
+}
+
+s_asynch_read_write_channel asynch_io_service::client_asynch_channel(std::error_code& ec, posix::fd_t fd, const asynch_callback& rc, const asynch_callback& wc) noexcept
+{
+	return s_asynch_read_write_channel( nobadalloc<posix::asynch_channel>::construct(ec, fd, this, rc, wc) );
+}
+
+s_asynch_read_write_channel asynch_io_service::file_asynch_channel(std::error_code& ec, const file& f, write_open_mode mode, const asynch_callback& rc, const asynch_callback& wc) noexcept
+{
+	static constexpr int DEFAULT_FILE_PERMS = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH;
+	int flags = O_RDWR;
+	switch(mode) {
+	case write_open_mode::append:
+		flags |= O_APPEND;
+		break;
+	case write_open_mode::create_if_not_exist:
+		flags |= O_CREAT;
+		break;
+	case write_open_mode::overwrite:
+		flags |= O_CREAT | O_TRUNC;
+		break;
+	}
+	std::string path = f.path();
+	posix::fd_t fd = ::open(path.data(), flags, DEFAULT_FILE_PERMS);
+	if(-1 == fd) {
+		ec.assign(errno, std::system_category() );
+		return s_asynch_read_write_channel();
+	}
+	s_asynch_read_write_channel ret = client_asynch_channel(ec, fd, rc, wc);
+	if( !ret )
+		::close(fd);
+	return ret;
+}
+
+::io_uring_sqe* asynch_io_service::next_sqe() noexcept
+{
+	unsigned int tail = *sq_tail_;
+	if( io_unlikely( (tail - load_acquire(sq_head_) ) >= sq_entries_ ) ) {
+		// submission queue is full, flush it
+		std::error_code ec;
+		submit(ec);
+		if( (tail - load_acquire(sq_head_) ) >= sq_entries_ )
+			return nullptr;
+	}
+	const unsigned int index = tail & *sq_mask_;
+	sq_array_[index] = index;
+	return &sqes_[index];
+}
+
+void asynch_io_service::push_sqe() noexcept
+{
+	store_release(sq_tail_, *sq_tail_ + 1);
+	++to_submit_;
+}
+
+asynch_io_service::operation* asynch_io_service::new_operation(const posix::asynch_channel* ch, std::size_t pos) noexcept
+{
+	operation *ret = free_ops_;
+	if( io_likely(nullptr != ret) ) {
+		free_ops_ = ret->next;
+		ret->ch.reset( const_cast<posix::asynch_channel*>(ch) );
+		ret->pos = pos;
+		ret->done = 0;
+		++in_flight_;
+	}
+	return ret;
+}
+
+void asynch_io_service::release_operation(operation* op) noexcept
+{
+	op->ch.reset();
+	op->buff = byte_buffer();
+	op->next = free_ops_;
+	free_ops_ = op;
+	--in_flight_;
+}
+
+void asynch_io_service::read(const posix::asynch_channel* ch, std::size_t bytes, std::size_t pos) noexcept
+{
+	std::error_code ec;
+	operation *op = new_operation(ch, pos);
+	if( io_unlikely(nullptr == op) ) {
+		ec = std::make_error_code(std::errc::resource_unavailable_try_again);
+		ch->on_read_finished(ec, pos, byte_buffer() );
+		return;
+	}
+	op->opcode = IORING_OP_READ;
+	// kernel reads directly into the buffer passed to the callback
+	op->buff = byte_buffer::allocate(ec, bytes);
+	if(ec) {
+		release_operation(op);
+		ch->on_read_finished(ec, pos, byte_buffer() );
+		return;
+	}
+	::io_uring_sqe *sqe = next_sqe();
+	if( io_unlikely(nullptr == sqe) ) {
+		release_operation(op);
+		ec = std::make_error_code(std::errc::resource_unavailable_try_again);
+		ch->on_read_finished(ec, pos, byte_buffer() );
+		return;
+	}
+	const uint64_t offset = ch->seekable_ ? pos : CURRENT_POSITION;
+	prepare_rw(sqe, IORING_OP_READ, ch->fd_, op->buff.position().get(), bytes, offset, reinterpret_cast<uint64_t>(op) );
+	push_sqe();
+}
+
+void asynch_io_service::queue_write(operation* op) noexcept
+{
+	::io_uring_sqe *sqe = next_sqe();
+	if( io_unlikely(nullptr == sqe) ) {
+		std::error_code ec = std::make_error_code(std::errc::resource_unavailable_try_again);
+		boost::intrusive_ptr<posix::asynch_channel> ch( std::move(op->ch) );
+		byte_buffer buff( std::move(op->buff) );
+		const std::size_t pos = op->pos;
+		release_operation(op);
+		ch->on_write_finished(ec, pos, std::move(buff) );
+		return;
+	}
+	const posix::asynch_channel *ch = op->ch.get();
+	const uint64_t offset = ch->seekable_ ? op->pos + op->done : CURRENT_POSITION;
+	prepare_rw(sqe, IORING_OP_WRITE, ch->fd_,
+			op->buff.position().get() + op->done,
+			op->buff.length() - op->done,
+			offset,
+			reinterpret_cast<uint64_t>(op) );
+	push_sqe();
+}
+
+void asynch_io_service::write(const posix::asynch_channel* ch, byte_buffer&& buff, std::size_t pos) noexcept
+{
+	operation *op = new_operation(ch, pos);
+	if( io_unlikely(nullptr == op) ) {
+		std::error_code ec = std::make_error_code(std::errc::resource_unavailable_try_again);
+		ch->on_write_finished(ec, pos, std::forward<byte_buffer>(buff) );
+		return;
+	}
+	op->opcode = IORING_OP_WRITE;
+	op->buff = std::forward<byte_buffer>(buff);
+	queue_write(op);
+}
+
+bool asynch_io_service::cancel(const posix::asynch_channel* ch, bool writes) noexcept
+{
+	bool ret = false;
+	for(unsigned int i = 0; i < queue_depth_; i++) {
+		if( ops_[i].ch.get() != ch || (!writes && IORING_OP_WRITE == ops_[i].opcode) )
+			continue;
+		::io_uring_sqe *sqe = next_sqe();
+		if(nullptr == sqe)
+			break;
+		prepare_rw(sqe, IORING_OP_ASYNC_CANCEL, -1, &ops_[i], 0, 0, CANCEL_USER_DATA);
+		push_sqe();
+		ret = true;
+	}
+	return ret;
+}
+
+void asynch_io_service::complete(operation* op, int res)
+{
+	std::error_code ec;
+	if(res < 0)
+		ec.assign(-res, std::system_category() );
+	const std::size_t pos = op->pos;
+	if(IORING_OP_WRITE == op->opcode) {
+		if(res > 0) {
+			op->done += static_cast<std::size_t>(res);
+			// re-queue the rest of partially written buffer
+			if(op->done < op->buff.length() ) {
+				queue_write(op);
+				return;
+			}
+		}
+		boost::intrusive_ptr<posix::asynch_channel> ch( std::move(op->ch) );
+		byte_buffer buff( std::move(op->buff) );
+		release_operation(op);
+		ch->on_write_finished(ec, pos, std::move(buff) );
+		return;
+	}
+	byte_buffer buff;
+	if(res > 0) {
+		buff = std::move(op->buff);
+		buff.move( static_cast<std::size_t>(res) );
+		buff.flip();
+	}
+	boost::intrusive_ptr<posix::asynch_channel> ch( std::move(op->ch) );
+	release_operation(op);
+	ch->on_read_finished(ec, pos, std::move(buff) );
+}
+
+std::size_t asynch_io_service::submit(std::error_code& ec) noexcept
+{
+	std::size_t ret = 0;
+	while(to_submit_ > 0) {
+		int submitted = io_uring_enter_syscall(ring_fd_, to_submit_, 0, 0);
+		if(-1 == submitted) {
+			if(EINTR == errno)
+				continue;
+			ec.assign(errno, std::system_category() );
+			break;
+		}
+		to_submit_ -= static_cast<unsigned int>(submitted);
+		ret += static_cast<std::size_t>(submitted);
+	}
+	return ret;
+}
+
+std::size_t asynch_io_service::run_once(std::error_code& ec, bool wait)
+{
+	if(wait && in_flight_ > 0) {
+		int submitted;
+		do {
+			submitted = io_uring_enter_syscall(ring_fd_, to_submit_, 1, IORING_ENTER_GETEVENTS);
+		} while(-1 == submitted && EINTR == errno);
+		if(-1 == submitted) {
+			ec.assign(errno, std::system_category() );
+			return 0;
+		}
+		to_submit_ -= static_cast<unsigned int>(submitted);
+	} else {
+		submit(ec);
+		if(ec)
+			return 0;
+	}
+	std::size_t ret = 0;
+	unsigned int head = *cq_head_;
+	while( head != load_acquire(cq_tail_) ) {
+		const ::io_uring_cqe* cqe = &cqes_[head & *cq_mask_];
+		const uint64_t user_data = cqe->user_data;
+		const int res = cqe->res;
+		store_release(cq_head_, ++head);
+		if(CANCEL_USER_DATA != user_data) {
+			complete( reinterpret_cast<operation*>(user_data), res);
+			++ret;
+		}
+	}
+	return ret;
+}
+
+void asynch_io_service::run(std::error_code& ec)
+{
+	while(in_flight_ > 0 && !ec)
+		run_once(ec, true);
+}
+
+namespace posix {
+
+// asynch_channel
+asynch_channel::asynch_channel(fd_t fd, asynch_io_service* service, const asynch_callback& rc, const asynch_callback& wc) noexcept:
+	asynch_read_write_channel(rc,wc),
+	fd_(fd),
+	seekable_( -1 != ::lseek(fd, 0, SEEK_CUR) ),
+	service_(service)
+{}
+
+asynch_channel::~asynch_channel() noexcept
+{
+	::close(fd_);
+}
+
+void asynch_channel::read(std::size_t bytes, std::size_t pos) const noexcept
+{
+	service_->read(this, bytes, pos);
+}
+
+void asynch_channel::write(byte_buffer&& buff, std::size_t pos) const noexcept
+{
+	service_->write(this, std::forward<byte_buffer>(buff), pos);
+}
+
+bool asynch_channel::cancel_pending() const noexcept
+{
+	return service_->cancel(this, false);
+}
+
+bool asynch_channel::cancel_all() const noexcept
+{
+	return service_->cancel(this, true);
+}
+
+} // namespace posix
+
+} // namespace io
+
+#endif // __linux__
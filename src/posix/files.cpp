@@ -14,6 +14,11 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+
+#ifdef __linux__
+#	include <sys/sendfile.h>
+#endif // __linux__
 
 
 #include <limits.h>
@@ -56,6 +61,36 @@ std::size_t synch_file_channel::write(std::error_code& ec, const uint8_t* buff,s
 	return static_cast<size_t>(result);
 }
 
+std::size_t synch_file_channel::readv(std::error_code& ec, const read_segment* segments, std::size_t count) const noexcept
+{
+	::ssize_t result = ::readv(fd_, to_iovec(segments), iov_count(count) );
+	if(result < 0) {
+		ec.assign(errno, std::system_category() );
+		return 0;
+	}
+	return static_cast<size_t>(result);
+}
+
+std::size_t synch_file_channel::writev(std::error_code& ec, const write_segment* segments, std::size_t count) const noexcept
+{
+	::ssize_t result = ::writev(fd_, to_iovec(segments), iov_count(count) );
+	if(result < 0) {
+		ec.assign(errno, std::system_category() );
+		return 0;
+	}
+	return static_cast<size_t>(result);
+}
+
+void synch_file_channel::flush(std::error_code& ec) const noexcept
+{
+	int ret;
+	do {
+		ret = ::fdatasync(fd_);
+	} while(-1 == ret && EINTR == errno);
+	if(-1 == ret)
+		ec.assign(errno, std::system_category() );
+}
+
 inline std::size_t synch_file_channel::seek(std::error_code& ec,file_offset_t offset, int whence) noexcept
 {
 	::file_offset_t res = ::lseek_syscall(fd_, offset, whence);
@@ -89,6 +124,156 @@ std::size_t synch_file_channel::position(std::error_code& ec) noexcept
 	return seek( ec, 0, SEEK_CUR);
 }
 
+// mapped_file_channel
+mapped_file_channel::mapped_file_channel(fd_t fd, std::size_t file_size, std::size_t window, int advice) noexcept:
+	view_read_channel(),
+	fd_(fd),
+	file_size_(file_size),
+	window_(window),
+	advice_(advice),
+	offset_(0),
+	map_(nullptr),
+	map_size_(0),
+	pos_(0)
+{}
+
+mapped_file_channel::~mapped_file_channel() noexcept
+{
+	unmap();
+	::close(fd_);
+}
+
+void mapped_file_channel::unmap() const noexcept
+{
+	if(nullptr != map_) {
+		::munmap( static_cast<void*>(map_), map_size_ );
+		map_ = nullptr;
+	}
+}
+
+bool mapped_file_channel::map_next(std::error_code& ec) const noexcept
+{
+	const std::size_t next_offset = offset_ + map_size_;
+	if( next_offset >= file_size_ )
+		return false;
+	unmap();
+	const std::size_t left = file_size_ - next_offset;
+	const std::size_t len = (0 == window_ || window_ > left) ? left : window_;
+	void *px = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd_, static_cast<file_offset_t>(next_offset) );
+	if( MAP_FAILED == px ) {
+		ec.assign(errno, std::system_category() );
+		map_size_ = 0;
+		return false;
+	}
+	::madvise(px, len, advice_);
+	// hint kernel to start reading ahead the whole window
+	if( MADV_SEQUENTIAL == advice_ )
+		::madvise(px, len, MADV_WILLNEED);
+	map_ = static_cast<uint8_t*>(px);
+	offset_ = next_offset;
+	map_size_ = len;
+	pos_ = 0;
+	return true;
+}
+
+read_view mapped_file_channel::fill(std::error_code& ec) const noexcept
+{
+	if( io_unlikely( pos_ >= map_size_ && !map_next(ec) ) )
+		return read_view();
+	return read_view( map_ + pos_, map_ + map_size_ );
+}
+
+void mapped_file_channel::consume(std::size_t bytes) const noexcept
+{
+	pos_ += bytes;
+	if(pos_ > map_size_)
+		pos_ = map_size_;
+}
+
+std::size_t mapped_file_channel::read(std::error_code& ec,uint8_t* const buff, std::size_t bytes) const noexcept
+{
+	read_view v = fill(ec);
+	std::size_t ret = v.size() < bytes ? v.size() : bytes;
+	if( ret > 0 ) {
+		io_memmove(buff, v.begin(), ret);
+		consume(ret);
+	}
+	return ret;
+}
+
+#ifdef __linux__
+
+// largest chunk Linux transfers with a single system call
+static constexpr std::size_t MAX_KERNEL_TRANSFER = 0x7ffff000;
+
+enum class kernel_transfer {
+	copy_file_range,
+	sendfile,
+	splice
+};
+
+static ::ssize_t kernel_transfer_chunk(kernel_transfer method, fd_t src, fd_t dst) noexcept
+{
+	switch(method) {
+	case kernel_transfer::copy_file_range:
+		return ::copy_file_range(src, nullptr, dst, nullptr, MAX_KERNEL_TRANSFER, 0);
+	case kernel_transfer::sendfile:
+		return ::sendfile(dst, src, nullptr, MAX_KERNEL_TRANSFER);
+	case kernel_transfer::splice:
+		return ::splice(src, nullptr, dst, nullptr, MAX_KERNEL_TRANSFER, SPLICE_F_MOVE);
+	}
+	return -1;
+}
+
+// errors reported when kernel does not support transfer between this kinds of descriptors
+static inline bool is_not_supported(int err) noexcept
+{
+	return EINVAL == err || ENOSYS == err || EXDEV == err || EOPNOTSUPP == err || EBADF == err;
+}
+
+bool kernel_transmit(std::error_code& ec, fd_t src, fd_t dst, std::size_t& transfered) noexcept
+{
+	transfered = 0;
+	struct stat sst, dst_st;
+	if( -1 == ::fstat(src, &sst) || -1 == ::fstat(dst, &dst_st) )
+		return false;
+	kernel_transfer methods[2];
+	std::size_t count = 0;
+	if( S_ISREG(sst.st_mode) ) {
+		if( S_ISREG(dst_st.st_mode) )
+			methods[count++] = kernel_transfer::copy_file_range;
+		methods[count++] = kernel_transfer::sendfile;
+	} else if( S_ISFIFO(sst.st_mode) || S_ISFIFO(dst_st.st_mode) ) {
+		methods[count++] = kernel_transfer::splice;
+	}
+	for(std::size_t i = 0; i < count; i++) {
+		::ssize_t ret;
+		do {
+			ret = kernel_transfer_chunk(methods[i], src, dst);
+			if(ret > 0)
+				transfered += static_cast<std::size_t>(ret);
+		} while( ret > 0 || (-1 == ret && EINTR == errno) );
+		if(0 == ret)
+			return true;
+		// fall back to the next method, only when nothing was transferred yet
+		if( 0 != transfered || !is_not_supported(errno) ) {
+			ec.assign(errno, std::system_category() );
+			return true;
+		}
+	}
+	return false;
+}
+
+#else
+
+bool kernel_transmit(std::error_code&, fd_t, fd_t, std::size_t& transfered) noexcept
+{
+	transfered = 0;
+	return false;
+}
+
+#endif // __linux__
+
 } // namesapace posix
 
 // file
@@ -128,11 +313,18 @@ std::size_t file::size() const noexcept
 
 static constexpr int DEFAULT_FILE_PERMS = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH;
 
+static constexpr int durability_flags(write_durability durability) noexcept
+{
+	return write_durability::full_sync == durability ? O_SYNC
+		: write_durability::data_sync == durability ? O_DSYNC
+		: 0;
+}
+
 bool file::create() noexcept
 {
 	if( name_.empty() || exist() )
 		return false;
-    int fd = ::open( name_.data(), O_WRONLY | O_CREAT | O_TRUNC | O_SYNC,
+    int fd = ::open( name_.data(), O_WRONLY | O_CREAT | O_TRUNC,
             DEFAULT_FILE_PERMS);
     if(-1 != fd) {
         ::close(fd);
@@ -148,7 +340,7 @@ s_read_channel file::open_for_read(std::error_code& ec) const noexcept
 		ec = std::make_error_code(std::errc::no_such_file_or_directory);
 		return s_read_channel();
 	}
-	int fd = ::open( name_.data(), O_RDONLY, O_SYNC);
+	int fd = ::open( name_.data(), O_RDONLY);
 	if(-1 == fd) {
 		ec.assign( errno, std::system_category() );
 		return s_read_channel();
@@ -156,24 +348,67 @@ s_read_channel file::open_for_read(std::error_code& ec) const noexcept
 	return s_read_channel( posix::new_sync_file_channel( ec, fd ) );
 }
 
-s_write_channel file::open_for_write(std::error_code& ec,write_open_mode mode) const noexcept
+s_view_read_channel file::open_for_mapped_read(std::error_code& ec, access_pattern pattern, std::size_t window) const noexcept
+{
+	if(name_.empty()) {
+		ec = std::make_error_code(std::errc::no_such_file_or_directory);
+		return s_view_read_channel();
+	}
+	int fd = ::open( name_.data(), O_RDONLY);
+	if(-1 == fd) {
+		ec.assign( errno, std::system_category() );
+		return s_view_read_channel();
+	}
+	struct ::stat st;
+	if( -1 == ::fstat(fd, &st) ) {
+		ec.assign( errno, std::system_category() );
+		::close(fd);
+		return s_view_read_channel();
+	}
+	int advice;
+	switch(pattern) {
+	case access_pattern::sequential:
+		advice = MADV_SEQUENTIAL;
+		break;
+	case access_pattern::random:
+		advice = MADV_RANDOM;
+		break;
+	default:
+		advice = MADV_NORMAL;
+		break;
+	}
+	// mapping offset must be aligned to the page size
+	if(0 != window) {
+		const std::size_t page = memory_traits::page_size();
+		window = ( (window + page - 1) / page ) * page;
+	}
+	posix::mapped_file_channel *ret = nobadalloc<posix::mapped_file_channel>::construct(ec, fd, static_cast<std::size_t>(st.st_size), window, advice);
+	if(nullptr == ret) {
+		::close(fd);
+		return s_view_read_channel();
+	}
+	return s_view_read_channel( ret );
+}
+
+s_write_channel file::open_for_write(std::error_code& ec,write_open_mode mode, write_durability durability) const noexcept
 {
 	if(name_.empty()) {
 		ec = std::make_error_code(std::errc::no_such_file_or_directory);
 		return s_write_channel();
 	}
+	const int sync_flags = durability_flags(durability);
 	int fd = -1;
 	switch(mode) {
 	case  write_open_mode::append:
-		fd = ::open( name_.data(), O_WRONLY | O_APPEND | O_SYNC);
+		fd = ::open( name_.data(), O_WRONLY | O_APPEND | sync_flags);
 		break;
 	case  write_open_mode::create_if_not_exist:
 	case  write_open_mode::overwrite:
         if(!exist()) {
-			constexpr int flags = O_WRONLY | O_CREAT | O_TRUNC | O_SYNC;
+			const int flags = O_WRONLY | O_CREAT | O_TRUNC | sync_flags;
             fd = ::open( name_.data(), flags, DEFAULT_FILE_PERMS);
         } else {
-        	constexpr int flags = O_WRONLY | O_TRUNC | O_SYNC;
+        	const int flags = O_WRONLY | O_TRUNC | sync_flags;
             fd = ::open( name_.data(), flags );
         }
 		break;
@@ -185,13 +420,13 @@ s_write_channel file::open_for_write(std::error_code& ec,write_open_mode mode) c
 	return s_write_channel( posix::new_sync_file_channel( ec, fd ) );
 }
 
-s_random_access_channel file::open_for_random_access(std::error_code& ec,write_open_mode mode) const noexcept
+s_random_access_channel file::open_for_random_access(std::error_code& ec,write_open_mode mode, write_durability durability) const noexcept
 {
 	if( name_.empty() ) {
 		ec = std::make_error_code(std::errc::no_such_file_or_directory);
 		return s_random_access_channel();
 	}
-	int fd = ::open( name_.data(), O_RDWR, O_SYNC);
+	int fd = ::open( name_.data(), O_RDWR | durability_flags(durability) );
 	if(-1 == fd) {
 		ec.assign( errno, std::system_category() );
 		return s_random_access_channel();
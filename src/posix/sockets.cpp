@@ -10,6 +10,7 @@
  */
 #include "stdafx.hpp"
 #include "sockets.hpp"
+#include "files.hpp"
 
 namespace io {
 
@@ -136,6 +137,36 @@ public:
 		}
 		return static_cast<::std::size_t>(ret);
 	}
+	virtual intptr_t native_handle() const noexcept override
+	{
+		return socket_;
+	}
+	virtual std::size_t readv(std::error_code& ec, const read_segment* segments, std::size_t count) const noexcept override
+	{
+		::msghdr msg;
+		std::memset(&msg, 0, sizeof(msg) );
+		msg.msg_iov = const_cast<::iovec*>( posix::to_iovec(segments) );
+		msg.msg_iovlen = posix::iov_count(count);
+		::ssize_t ret = ::recvmsg(socket_, &msg, 0);
+		if(SOCKET_ERROR == ret) {
+			ec.assign( errno, std::system_category() );
+			return 0;
+		}
+		return static_cast<::std::size_t>(ret);
+	}
+	virtual std::size_t writev(std::error_code& ec, const write_segment* segments, std::size_t count) const noexcept override
+	{
+		::msghdr msg;
+		std::memset(&msg, 0, sizeof(msg) );
+		msg.msg_iov = const_cast<::iovec*>( posix::to_iovec(segments) );
+		msg.msg_iovlen = posix::iov_count(count);
+		::ssize_t ret = ::sendmsg(socket_, &msg, 0);
+		if(SOCKET_ERROR == ret) {
+			ec.assign( errno, std::system_category() );
+			return 0;
+		}
+		return static_cast<::std::size_t>(ret);
+	}
 	virtual std::size_t write(std::error_code& ec, const uint8_t* buff,std::size_t size) const noexcept override
 	{
 		::ssize_t ret = ::send(socket_, static_cast<const void*>(buff), size,  0);
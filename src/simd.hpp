@@ -0,0 +1,683 @@
+/*
+ *
+ * Copyright (c) 2016-2019
+ * Viktor Gubin
+ *
+ * Use, modification and distribution are subject to the
+ * Boost Software License, Version 1.0. (See accompanying file
+ * LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+#ifndef __IO_SIMD_HPP_INCLUDED__
+#define __IO_SIMD_HPP_INCLUDED__
+
+#include "config.hpp"
+
+#ifdef HAS_PRAGMA_ONCE
+#pragma once
+#endif // HAS_PRAGMA_ONCE
+
+#if defined(__AVX2__)
+#	include <immintrin.h>
+#	define IO_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_AMD64) || ( defined(_M_IX86_FP) && (_M_IX86_FP >= 2) )
+#	include <emmintrin.h>
+#	define IO_SIMD_SSE2 1
+#endif
+
+#if defined(IO_SIMD_AVX2) || defined(IO_SIMD_SSE2)
+#	define IO_HAS_SIMD 1
+#endif
+
+#include "charsetcvt.hpp"
+
+namespace io {
+
+namespace simd {
+
+// Block wise byte scanning primitives.
+// Instruction set is selected at compile time, AVX2 when enabled by compiler options (release builds),
+// SSE2 which is always available on x86_64, and portable scalar code otherwise.
+// Every function handles unaligned head and tail, and never reads after the end pointer
+
+#if defined(IO_SIMD_AVX2)
+
+static constexpr std::size_t BLOCK_SIZE = 32;
+
+// bit mask with all block bytes set
+static constexpr unsigned int FULL_MASK = 0xFFFFFFFF;
+
+typedef __m256i block_t;
+
+inline block_t load(const char* p) noexcept
+{
+	return _mm256_loadu_si256( reinterpret_cast<const __m256i*>(p) );
+}
+
+inline block_t splat(const char c) noexcept
+{
+	return _mm256_set1_epi8(c);
+}
+
+// bit mask of block bytes equals to c
+inline unsigned int eq_mask(const block_t& b, const block_t& c) noexcept
+{
+	return static_cast<unsigned int>( _mm256_movemask_epi8( _mm256_cmpeq_epi8(b, c) ) );
+}
+
+// bit mask of block bytes with highest bit set, i.e. not ASCII
+inline unsigned int high_mask(const block_t& b) noexcept
+{
+	return static_cast<unsigned int>( _mm256_movemask_epi8(b) );
+}
+
+// bit mask of UTF-8 continuation bytes i.e. 10xxxxxx
+inline unsigned int tail_mask(const block_t& b) noexcept
+{
+	// 10xxxxxx signed values are [-128,-65]
+	return static_cast<unsigned int>( _mm256_movemask_epi8( _mm256_cmpgt_epi8( _mm256_set1_epi8(-64), b) ) );
+}
+
+// narrows BLOCK_SIZE 16 bit code units into bytes when all of them are ASCII,
+// big endian units are shifted into low byte after the check
+template<bool BigEndian>
+inline bool narrow_ascii16(const uint8_t* b, char* to) noexcept
+{
+	const __m256i mask = _mm256_set1_epi16( BigEndian ? 0x80FF : static_cast<short>(0xFF80) );
+	__m256i v0 = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(b) );
+	__m256i v1 = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(b + 32) );
+	if( !_mm256_testz_si256( _mm256_or_si256(v0, v1), mask ) )
+		return false;
+	if(BigEndian) {
+		v0 = _mm256_srli_epi16(v0, 8);
+		v1 = _mm256_srli_epi16(v1, 8);
+	}
+	// pack works by 128 bit lanes, so that quad words should be reordered
+	const __m256i r = _mm256_permute4x64_epi64( _mm256_packus_epi16(v0, v1), 0xD8 );
+	_mm256_storeu_si256( reinterpret_cast<__m256i*>(to), r );
+	return true;
+}
+
+// narrows BLOCK_SIZE 32 bit code units into bytes when all of them are ASCII
+template<bool BigEndian>
+inline bool narrow_ascii32(const uint8_t* b, char* to) noexcept
+{
+	const __m256i mask = _mm256_set1_epi32( BigEndian ? 0x80FFFFFF : static_cast<int>(0xFFFFFF80) );
+	__m256i v0 = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(b) );
+	__m256i v1 = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(b + 32) );
+	__m256i v2 = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(b + 64) );
+	__m256i v3 = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(b + 96) );
+	if( !_mm256_testz_si256( _mm256_or_si256( _mm256_or_si256(v0, v1), _mm256_or_si256(v2, v3) ), mask ) )
+		return false;
+	if(BigEndian) {
+		v0 = _mm256_srli_epi32(v0, 24);
+		v1 = _mm256_srli_epi32(v1, 24);
+		v2 = _mm256_srli_epi32(v2, 24);
+		v3 = _mm256_srli_epi32(v3, 24);
+	}
+	const __m256i p = _mm256_packus_epi16( _mm256_packs_epi32(v0, v1), _mm256_packs_epi32(v2, v3) );
+	// double words of the lanes are interleaved by packing
+	const __m256i r = _mm256_permutevar8x32_epi32( p, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7) );
+	_mm256_storeu_si256( reinterpret_cast<__m256i*>(to), r );
+	return true;
+}
+
+// UTF-8 validation of 32 bytes block by the nibbles lookup algorithm (J. Keiser, D. Lemire),
+// every byte pair is classified by high and low nibbles of the first byte and high nibble of the second byte.
+// prev is the previous block, returns non zero block when there is a malformed sequence
+// which ends in this block. Characters cut by the block end are checked with the next block
+inline block_t utf8_block_errors(const block_t& in, const block_t& prev) noexcept
+{
+	constexpr char TOO_SHORT = 1 << 0;
+	constexpr char TOO_LONG = 1 << 1;
+	constexpr char OVERLONG_3 = 1 << 2;
+	constexpr char TOO_LARGE = 1 << 3;
+	constexpr char SURROGATE = 1 << 4;
+	constexpr char OVERLONG_2 = 1 << 5;
+	constexpr char TOO_LARGE_1000 = 1 << 6;
+	constexpr char OVERLONG_4 = 1 << 6;
+	constexpr char TWO_CONTS = static_cast<char>(1 << 7);
+	constexpr char CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+	const block_t byte_1_high_table = _mm256_setr_epi8(
+		TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+		TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+		TOO_SHORT | OVERLONG_2,
+		TOO_SHORT,
+		TOO_SHORT | OVERLONG_3 | SURROGATE,
+		TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+		TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+		TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+		TOO_SHORT | OVERLONG_2,
+		TOO_SHORT,
+		TOO_SHORT | OVERLONG_3 | SURROGATE,
+		TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+	const block_t byte_1_low_table = _mm256_setr_epi8(
+		CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+		CARRY | OVERLONG_2,
+		CARRY,
+		CARRY,
+		CARRY | TOO_LARGE,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+		CARRY | OVERLONG_2,
+		CARRY,
+		CARRY,
+		CARRY | TOO_LARGE,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000);
+	const block_t byte_2_high_table = _mm256_setr_epi8(
+		TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+		TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+		TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+		TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+	const block_t nibble = _mm256_set1_epi8(0x0F);
+	// previous bytes of every block byte, crossing the 128 bit lanes
+	const block_t prev_lanes = _mm256_permute2x128_si256(prev, in, 0x21);
+	const block_t prev1 = _mm256_alignr_epi8(in, prev_lanes, 15);
+	const block_t prev2 = _mm256_alignr_epi8(in, prev_lanes, 14);
+	const block_t prev3 = _mm256_alignr_epi8(in, prev_lanes, 13);
+	const block_t byte_1_high = _mm256_shuffle_epi8(byte_1_high_table, _mm256_and_si256( _mm256_srli_epi16(prev1, 4), nibble) );
+	const block_t byte_1_low = _mm256_shuffle_epi8(byte_1_low_table, _mm256_and_si256(prev1, nibble) );
+	const block_t byte_2_high = _mm256_shuffle_epi8(byte_2_high_table, _mm256_and_si256( _mm256_srli_epi16(in, 4), nibble) );
+	const block_t special = _mm256_and_si256( _mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+	// third and fourth bytes of three and four bytes characters must be continuations
+	const block_t third = _mm256_subs_epu8(prev2, _mm256_set1_epi8( static_cast<char>(0xE0 - 0x80) ) );
+	const block_t fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8( static_cast<char>(0xF0 - 0x80) ) );
+	const block_t must23 = _mm256_and_si256( _mm256_or_si256(third, fourth), _mm256_set1_epi8( static_cast<char>(0x80) ) );
+	return _mm256_xor_si256(must23, special);
+}
+
+// non zero when block ends with a multi-byte character lead or a cut character
+inline block_t utf8_block_incomplete(const block_t& in) noexcept
+{
+	const block_t max = _mm256_setr_epi8(
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1) );
+	return _mm256_subs_epu8(in, max);
+}
+
+inline bool is_zero(const block_t& b) noexcept
+{
+	return 0 != _mm256_testz_si256(b, b);
+}
+
+#elif defined(IO_SIMD_SSE2)
+
+static constexpr std::size_t BLOCK_SIZE = 16;
+
+// bit mask with all block bytes set
+static constexpr unsigned int FULL_MASK = 0xFFFF;
+
+typedef __m128i block_t;
+
+inline block_t load(const char* p) noexcept
+{
+	return _mm_loadu_si128( reinterpret_cast<const __m128i*>(p) );
+}
+
+inline block_t splat(const char c) noexcept
+{
+	return _mm_set1_epi8(c);
+}
+
+// bit mask of block bytes equals to c
+inline unsigned int eq_mask(const block_t& b, const block_t& c) noexcept
+{
+	return static_cast<unsigned int>( _mm_movemask_epi8( _mm_cmpeq_epi8(b, c) ) );
+}
+
+// bit mask of block bytes with highest bit set, i.e. not ASCII
+inline unsigned int high_mask(const block_t& b) noexcept
+{
+	return static_cast<unsigned int>( _mm_movemask_epi8(b) );
+}
+
+// bit mask of UTF-8 continuation bytes i.e. 10xxxxxx
+inline unsigned int tail_mask(const block_t& b) noexcept
+{
+	// 10xxxxxx signed values are [-128,-65]
+	return static_cast<unsigned int>( _mm_movemask_epi8( _mm_cmplt_epi8(b, _mm_set1_epi8(-64) ) ) );
+}
+
+// checks all bits of mask are zero in the value
+inline bool test_zero(const __m128i& v, const __m128i& mask) noexcept
+{
+	return 0xFFFF == _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_and_si128(v, mask), _mm_setzero_si128() ) );
+}
+
+// narrows BLOCK_SIZE 16 bit code units into bytes when all of them are ASCII,
+// big endian units are shifted into low byte after the check
+template<bool BigEndian>
+inline bool narrow_ascii16(const uint8_t* b, char* to) noexcept
+{
+	const __m128i mask = _mm_set1_epi16( BigEndian ? 0x80FF : static_cast<short>(0xFF80) );
+	__m128i v0 = _mm_loadu_si128( reinterpret_cast<const __m128i*>(b) );
+	__m128i v1 = _mm_loadu_si128( reinterpret_cast<const __m128i*>(b + 16) );
+	if( !test_zero( _mm_or_si128(v0, v1), mask ) )
+		return false;
+	if(BigEndian) {
+		v0 = _mm_srli_epi16(v0, 8);
+		v1 = _mm_srli_epi16(v1, 8);
+	}
+	_mm_storeu_si128( reinterpret_cast<__m128i*>(to), _mm_packus_epi16(v0, v1) );
+	return true;
+}
+
+// narrows BLOCK_SIZE 32 bit code units into bytes when all of them are ASCII
+template<bool BigEndian>
+inline bool narrow_ascii32(const uint8_t* b, char* to) noexcept
+{
+	const __m128i mask = _mm_set1_epi32( BigEndian ? 0x80FFFFFF : static_cast<int>(0xFFFFFF80) );
+	__m128i v0 = _mm_loadu_si128( reinterpret_cast<const __m128i*>(b) );
+	__m128i v1 = _mm_loadu_si128( reinterpret_cast<const __m128i*>(b + 16) );
+	__m128i v2 = _mm_loadu_si128( reinterpret_cast<const __m128i*>(b + 32) );
+	__m128i v3 = _mm_loadu_si128( reinterpret_cast<const __m128i*>(b + 48) );
+	if( !test_zero( _mm_or_si128( _mm_or_si128(v0, v1), _mm_or_si128(v2, v3) ), mask ) )
+		return false;
+	if(BigEndian) {
+		v0 = _mm_srli_epi32(v0, 24);
+		v1 = _mm_srli_epi32(v1, 24);
+		v2 = _mm_srli_epi32(v2, 24);
+		v3 = _mm_srli_epi32(v3, 24);
+	}
+	const __m128i r = _mm_packus_epi16( _mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3) );
+	_mm_storeu_si128( reinterpret_cast<__m128i*>(to), r );
+	return true;
+}
+
+#endif // IO_SIMD_AVX2
+
+inline bool is_utf8_tail(const char c) noexcept
+{
+	return 0x80 == ( static_cast<uint8_t>(c) & 0xC0 );
+}
+
+/// Finds first byte equals to one of the three characters
+/// \param b range begin
+/// \param e range end
+/// \return pointer on found byte, or e when no such byte in range
+inline const char* find_first_of(const char* b, const char* e, const char c1, const char c2, const char c3) noexcept
+{
+#ifdef IO_HAS_SIMD
+	const block_t v1 = splat(c1);
+	const block_t v2 = splat(c2);
+	const block_t v3 = splat(c3);
+	for(; memory_traits::distance(b, e) >= BLOCK_SIZE; b += BLOCK_SIZE) {
+		const block_t v = load(b);
+		const unsigned int m = eq_mask(v, v1) | eq_mask(v, v2) | eq_mask(v, v3);
+		if( 0 != m )
+			return b + io_ctz(m);
+	}
+#endif // IO_HAS_SIMD
+	for(; b < e; b++) {
+		if( *b == c1 || *b == c2 || *b == c3 )
+			break;
+	}
+	return b;
+}
+
+/// Finds first byte equals to one of the four characters
+/// \param b range begin
+/// \param e range end
+/// \return pointer on found byte, or e when no such byte in range
+inline const char* find_first_of(const char* b, const char* e, const char c1, const char c2, const char c3, const char c4) noexcept
+{
+#ifdef IO_HAS_SIMD
+	const block_t v1 = splat(c1);
+	const block_t v2 = splat(c2);
+	const block_t v3 = splat(c3);
+	const block_t v4 = splat(c4);
+	for(; memory_traits::distance(b, e) >= BLOCK_SIZE; b += BLOCK_SIZE) {
+		const block_t v = load(b);
+		const unsigned int m = eq_mask(v, v1) | eq_mask(v, v2) | eq_mask(v, v3) | eq_mask(v, v4);
+		if( 0 != m )
+			return b + io_ctz(m);
+	}
+#endif // IO_HAS_SIMD
+	for(; b < e; b++) {
+		if( *b == c1 || *b == c2 || *b == c3 || *b == c4 )
+			break;
+	}
+	return b;
+}
+
+/// Skips XML white space characters i.e. space, tab, carriage return and line feed
+/// \param b range begin
+/// \param e range end
+/// \return pointer on first non white space byte, or e when whole range is white space
+inline const char* skip_spaces(const char* b, const char* e) noexcept
+{
+#ifdef IO_HAS_SIMD
+	const block_t sp = splat(' ');
+	const block_t tab = splat('\t');
+	const block_t cr = splat('\r');
+	const block_t nl = splat('\n');
+	for(; memory_traits::distance(b, e) >= BLOCK_SIZE; b += BLOCK_SIZE) {
+		const block_t v = load(b);
+		const unsigned int m = FULL_MASK & ~( eq_mask(v, sp) | eq_mask(v, tab) | eq_mask(v, cr) | eq_mask(v, nl) );
+		if( 0 != m )
+			return b + io_ctz(m);
+	}
+#endif // IO_HAS_SIMD
+	for(; b < e; b++) {
+		if( ' ' != *b && '\t' != *b && '\r' != *b && '\n' != *b )
+			break;
+	}
+	return b;
+}
+
+/// Finds first byte equals to the character
+/// \param b range begin
+/// \param e range end
+/// \return pointer on found byte, or e when no such byte in range
+inline const char* find(const char* b, const char* e, const char c) noexcept
+{
+	const void* ret = io_memchr(b, static_cast<int>(c), memory_traits::distance(b, e) );
+	return nullptr == ret ? e : static_cast<const char*>(ret);
+}
+
+/// Counts bytes equals to the character
+/// \param b range begin
+/// \param e range end
+/// \param c character to count
+/// \return count of characters
+inline std::size_t count(const char* b, const char* e, const char c) noexcept
+{
+	std::size_t ret = 0;
+#ifdef IO_HAS_SIMD
+	const block_t vc = splat(c);
+	for(; memory_traits::distance(b, e) >= BLOCK_SIZE; b += BLOCK_SIZE)
+		ret += io_popcount( eq_mask( load(b), vc) );
+#endif // IO_HAS_SIMD
+	for(; b < e; b++) {
+		if( c == *b )
+			++ret;
+	}
+	return ret;
+}
+
+/// Counts UTF-8 characters i.e. all bytes except multi-byte tails, range expected to be a valid UTF-8
+/// \param b range begin
+/// \param e range end
+/// \return count of UTF-8 characters
+inline std::size_t utf8_length(const char* b, const char* e) noexcept
+{
+	std::size_t ret = memory_traits::distance(b, e);
+#ifdef IO_HAS_SIMD
+	for(; memory_traits::distance(b, e) >= BLOCK_SIZE; b += BLOCK_SIZE)
+		ret -= io_popcount( tail_mask( load(b) ) );
+#endif // IO_HAS_SIMD
+	for(; b < e; b++) {
+		if( is_utf8_tail(*b) )
+			--ret;
+	}
+	return ret;
+}
+
+// count of bytes in a character by it's first byte, 0 when byte can not start a character
+// i.e. a multi-byte tail, overlong two bytes lead or a lead of code point after U+10FFFF
+inline unsigned int utf8_lead_length(const uint8_t c) noexcept
+{
+	return c < 0x80 ? 1 : c < 0xC2 ? 0 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : c < 0xF5 ? 4 : 0;
+}
+
+// checks second byte of a multi-byte character, range depends on the lead byte
+// to exclude overlong forms, UTF-16 surrogates and code points after U+10FFFF
+inline bool is_utf8_second(const uint8_t lead, const uint8_t c) noexcept
+{
+	switch(lead) {
+	case 0xE0:
+		return c >= 0xA0 && c <= 0xBF;
+	case 0xED:
+		return c >= 0x80 && c <= 0x9F;
+	case 0xF0:
+		return c >= 0x90 && c <= 0xBF;
+	case 0xF4:
+		return c >= 0x80 && c <= 0x8F;
+	default:
+		return is_utf8_tail( static_cast<char>(c) );
+	}
+}
+
+/// Checks range is a well formed beginning of a multi-byte character, which is cut by the range end
+/// \param b range begin
+/// \param e range end
+/// \return whether character can be completed by the next bytes
+inline bool is_utf8_prefix(const char* b, const char* e) noexcept
+{
+	const std::size_t size = memory_traits::distance(b, e);
+	const uint8_t* p = reinterpret_cast<const uint8_t*>(b);
+	if( 0 == size || size >= utf8_lead_length(p[0]) )
+		return false;
+	return ( size < 2 || is_utf8_second(p[0], p[1]) ) && ( size < 3 || is_utf8_tail(b[2]) );
+}
+
+/// Validates UTF-8 characters sequence, rejects stray or missing multi-byte tails, overlong forms,
+/// UTF-16 surrogates and code points after U+10FFFF. Blocks are checked by the lookup algorithm with AVX2,
+/// or ASCII blocks are skipped with SSE2, and multi-byte characters are checked one by one.
+/// \param b range begin, expected to be a character start
+/// \param e range end
+/// \return e when whole range is well formed UTF-8, or exact pointer on first malformed
+///			or incomplete (i.e. cut by range end) character
+inline const char* utf8_validate(const char* b, const char* e) noexcept
+{
+#ifdef IO_SIMD_AVX2
+	if( memory_traits::distance(b, e) >= BLOCK_SIZE ) {
+		const char* start = b;
+		block_t prev = _mm256_setzero_si256();
+		block_t incomplete = prev;
+		for(; memory_traits::distance(b, e) >= BLOCK_SIZE; b += BLOCK_SIZE) {
+			const block_t in = load(b);
+			if( 0 == high_mask(in) ) {
+				// ASCII block, previous block should not end with a cut character
+				if( !is_zero(incomplete) )
+					break;
+			} else {
+				if( !is_zero( utf8_block_errors(in, prev) ) )
+					break;
+				incomplete = utf8_block_incomplete(in);
+			}
+			prev = in;
+		}
+		// exact error position or the last cut character is found by the character wise check,
+		// from the start of the last character before the failed block or the range end
+		if(b > start) {
+			--b;
+			for(unsigned int i = 0; i < 3 && b > start && is_utf8_tail(*b); i++)
+				--b;
+		}
+	}
+#endif // IO_SIMD_AVX2
+	while(b < e) {
+#ifdef IO_HAS_SIMD
+		if( memory_traits::distance(b, e) >= BLOCK_SIZE ) {
+			const unsigned int m = high_mask( load(b) );
+			if( 0 == m ) {
+				b += BLOCK_SIZE;
+				continue;
+			}
+			b += io_ctz(m);
+		}
+#endif // IO_HAS_SIMD
+		const uint8_t* p = reinterpret_cast<const uint8_t*>(b);
+		const unsigned int len = utf8_lead_length(p[0]);
+		if( io_likely(1 == len) ) {
+			++b;
+			continue;
+		}
+		if( 0 == len || memory_traits::distance(b, e) < len || !is_utf8_second(p[0], p[1]) )
+			return b;
+		if( len > 2 && !is_utf8_tail(b[2]) )
+			return b;
+		if( len > 3 && !is_utf8_tail(b[3]) )
+			return b;
+		b += len;
+	}
+	return b;
+}
+
+// loads 16 or 32 bit code unit
+template<std::size_t U, bool BigEndian>
+inline uint32_t load_unit(const uint8_t* p) noexcept
+{
+	if(2 == U)
+		return BigEndian ? (uint32_t(p[0]) << 8) | p[1] : (uint32_t(p[1]) << 8) | p[0];
+	return BigEndian
+		? (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3]
+		: (uint32_t(p[3]) << 24) | (uint32_t(p[2]) << 16) | (uint32_t(p[1]) << 8) | p[0];
+}
+
+#ifdef IO_HAS_SIMD
+template<std::size_t U, bool BigEndian>
+inline bool narrow_ascii(const uint8_t* b, char* to) noexcept
+{
+	return 2 == U ? narrow_ascii16<BigEndian>(b, to) : narrow_ascii32<BigEndian>(b, to);
+}
+#endif // IO_HAS_SIMD
+
+/// Transcodes UTF-16 or UTF-32 code units into UTF-8. Blocks of ASCII code units are narrowed without decoding.
+/// Transcoding stops before a code unit or a surrogate pair cut by the range end, so that it can be transcoded
+/// with the next portion of data, or before a character which does not fit into destination
+/// \tparam U code unit size in bytes, 2 for UTF-16 and 4 for UTF-32
+/// \tparam BigEndian whether code units are in big endian byte order
+/// \param b source range begin
+/// \param e source range end
+/// \param to destination, moved after the last written byte
+/// \param to_end destination end
+/// \param malformed set when transcoding stopped on unpaired surrogate or invalid code point
+/// \return pointer after the last transcoded code unit
+template<std::size_t U, bool BigEndian>
+inline const uint8_t* utf_to_utf8(const uint8_t* b, const uint8_t* e, char*& to, char* const to_end, bool& malformed) noexcept
+{
+	static_assert(2 == U || 4 == U, "UTF-16 or UTF-32 code units expected");
+	malformed = false;
+	char* out = to;
+#ifdef IO_HAS_SIMD
+	// code units before this position are known to be not an ASCII block
+	const uint8_t* scalar_end = b;
+#endif // IO_HAS_SIMD
+	while( memory_traits::distance(b, e) >= U ) {
+#ifdef IO_HAS_SIMD
+		if( b >= scalar_end && memory_traits::distance(b, e) >= (U * BLOCK_SIZE) && memory_traits::distance(out, to_end) >= BLOCK_SIZE ) {
+			if( narrow_ascii<U, BigEndian>(b, out) ) {
+				b += U * BLOCK_SIZE;
+				out += BLOCK_SIZE;
+				continue;
+			}
+			scalar_end = b + (U * BLOCK_SIZE);
+		}
+#endif // IO_HAS_SIMD
+		uint32_t c = load_unit<U, BigEndian>(b);
+		std::size_t len = U;
+		if( 2 == U && c >= 0xD800 && c <= 0xDFFF ) {
+			// low surrogate without high surrogate
+			if( c > 0xDBFF ) {
+				malformed = true;
+				break;
+			}
+			if( memory_traits::distance(b, e) < 4 )
+				break;
+			const uint32_t low = load_unit<U, BigEndian>(b + 2);
+			if( low < 0xDC00 || low > 0xDFFF ) {
+				malformed = true;
+				break;
+			}
+			c = 0x10000 + ( (c - 0xD800) << 10 ) + (low - 0xDC00);
+			len = 4;
+		}
+		const std::size_t mblen = c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+		if( memory_traits::distance(out, to_end) < mblen )
+			break;
+		char* next = utf8::char32tomb(out, static_cast<char32_t>(c) );
+		if( nullptr == next ) {
+			malformed = true;
+			break;
+		}
+		out = next;
+		b += len;
+	}
+	to = out;
+	return b;
+}
+
+// windows-1252 characters of 0x80 - 0x9F range, zero for the not defined bytes
+static constexpr uint16_t CP1252_C1[32] = {
+	0x20AC, 0, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021, 0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0, 0x017D, 0,
+	0, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0, 0x017E, 0x0178
+};
+
+/// Transcodes ISO-8859-1 or windows-1252 bytes into UTF-8. Blocks of ASCII bytes are copied without decoding.
+/// Transcoding stops before a character which does not fit into destination
+/// 	param Windows1252 whether 0x80 - 0x9F bytes are windows-1252 characters instead of C1 controls
+/// \param b source range begin
+/// \param e source range end
+/// \param to destination, moved after the last written byte
+/// \param to_end destination end
+/// \param malformed set when transcoding stopped on a byte which is not defined by windows-1252
+/// \return pointer after the last transcoded byte
+template<bool Windows1252>
+inline const uint8_t* latin1_to_utf8(const uint8_t* b, const uint8_t* e, char*& to, char* const to_end, bool& malformed) noexcept
+{
+	malformed = false;
+	char* out = to;
+	while( b < e ) {
+#ifdef IO_HAS_SIMD
+		if( memory_traits::distance(b, e) >= BLOCK_SIZE && memory_traits::distance(out, to_end) >= BLOCK_SIZE
+			&& 0 == high_mask( load( reinterpret_cast<const char*>(b) ) ) ) {
+			io_memmove(out, b, BLOCK_SIZE);
+			b += BLOCK_SIZE;
+			out += BLOCK_SIZE;
+			continue;
+		}
+#endif // IO_HAS_SIMD
+		uint32_t c = *b;
+		if( Windows1252 && c >= 0x80 && c <= 0x9F ) {
+			c = CP1252_C1[c - 0x80];
+			if( 0 == c ) {
+				malformed = true;
+				break;
+			}
+		}
+		const std::size_t mblen = c < 0x80 ? 1 : c < 0x800 ? 2 : 3;
+		if( memory_traits::distance(out, to_end) < mblen )
+			break;
+		out = utf8::char32tomb(out, static_cast<char32_t>(c) );
+		++b;
+	}
+	to = out;
+	return b;
+}
+
+} // namespace simd
+
+} // namespace io
+
+#endif // __IO_SIMD_HPP_INCLUDED__
@@ -23,7 +23,8 @@ s_string_pool string_pool::create(std::error_code& ec) noexcept
 
 string_pool::string_pool() noexcept:
 	object(),
-	pool_()
+	table_(),
+	size_(0)
 {
 }
 
@@ -31,43 +32,68 @@ string_pool::~string_pool() noexcept
 {
 }
 
-const cached_string string_pool::get(const char* s, std::size_t count) noexcept
+// linear probing from the hash slot, returns slot of the string or the first free slot
+std::size_t string_pool::find(std::size_t hash, const char* s, std::size_t count) const noexcept
 {
-	typedef pool_type::value_type pair_type;
+	const std::size_t mask = table_.size() - 1;
+	std::size_t i = hash & mask;
+	while( !table_[i].str.empty() && ( hash != table_[i].hash || !table_[i].str.equal(s, count) ) )
+		i = (i + 1) & mask;
+	return i;
+}
 
-	if( io_unlikely( (nullptr == s || '\0' == *s || count == 0 ) ) )
-		return cached_string();
-	if( count > detail::SSO_MAX ) {
-		const std::size_t str_hash = io::hash_bytes(s,count);
-		pool_type::iterator it = pool_.find( str_hash );
-		if( it != pool_.end() ) {
-			// handle hash-miss collision
-			// more likely never happens, since City Hash
-			if( io_unlikely( pool_.count( str_hash ) > 1 ) ) {
-				auto its = pool_.equal_range( str_hash );
-				it = std::find_if(its.first, its.second, [s,count] (const pair_type& entry) {
-					return entry.second.equal(s, count);
-				} );
-			}
-			return it->second;
-		}
+bool string_pool::rehash(std::size_t capacity) noexcept
+{
 #ifndef IO_NO_EXCEPTIONS
-		try {
+	try {
 #endif // IO_NO_EXCEPTIONS
-			std::pair<pool_type::iterator,bool> ret = pool_.emplace( str_hash, cached_string(s, count) );
-			if( io_likely( ret.second ) )
-				return ret.first->second;
-#ifndef IO_NO_EXCEPTIONS
-		}
-		catch(std::exception&) {
-			// skip out of memory, and return string as it is
-			// i.e. empty string
+		table_type table(capacity);
+		const std::size_t mask = capacity - 1;
+		for(entry& e: table_) {
+			if( e.str.empty() )
+				continue;
+			std::size_t i = e.hash & mask;
+			while( !table[i].str.empty() )
+				i = (i + 1) & mask;
+			table[i].hash = e.hash;
+			table[i].str = std::move(e.str);
 		}
-#endif // IO_NO_EXCEPTIONS
+		table_.swap(table);
+#ifndef IO_NO_EXCEPTIONS
 	}
+	catch(std::exception&) {
+		return false;
+	}
+#endif // IO_NO_EXCEPTIONS
+	return true;
+}
+
+const cached_string string_pool::get(const char* s, std::size_t count) noexcept
+{
+	if( io_unlikely( (nullptr == s || '\0' == *s || count == 0 ) ) )
+		return cached_string();
 	// no problem on SSO string, it should not be pulled since
 	// all data stored inside string object it self
-	return cached_string(s, count);
+	if( count <= detail::SSO_MAX )
+		return cached_string(s, count);
+	const std::size_t str_hash = io::hash_bytes(s,count);
+	std::size_t i = table_.empty() ? 0 : find(str_hash, s, count);
+	if( !table_.empty() && !table_[i].str.empty() )
+		return table_[i].str;
+	// table is kept at most half full, so that probe sequences are short
+	if( (size_ << 1) >= table_.size() ) {
+		// skip out of memory, and return string as it is
+		if( io_unlikely( !rehash( table_.empty() ? INITIAL_CAPACITY : table_.size() << 1 ) ) )
+			return cached_string(s, count);
+		i = find(str_hash, s, count);
+	}
+	cached_string ret(s, count);
+	if( io_likely( !ret.empty() ) ) {
+		table_[i].hash = str_hash;
+		table_[i].str = ret;
+		++size_;
+	}
+	return ret;
 }
 
 } // namespace io
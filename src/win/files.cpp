@@ -40,6 +40,12 @@ std::size_t synch_file_channel::write(std::error_code& err, const uint8_t* buff,
 	return hch_.write(err, buff, size);
 }
 
+void synch_file_channel::flush(std::error_code& err) const noexcept
+{
+	if( FALSE == ::FlushFileBuffers( hch_ ) )
+		err.assign( ::GetLastError(), std::system_category() );
+}
+
 std::size_t synch_file_channel::forward(std::error_code& err,std::size_t size) noexcept
 {
 	return hch_.seek(err, detail::whence_type::current, static_cast<int64_t>(size) );
@@ -143,6 +149,11 @@ static inline win::synch_file_channel* create_file_channel(std::error_code& err,
 }
 
 
+static constexpr ::DWORD durability_flags(write_durability durability) noexcept
+{
+	return write_durability::none == durability ? FILE_ATTRIBUTE_NORMAL : FILE_ATTRIBUTE_NORMAL | FILE_FLAG_WRITE_THROUGH;
+}
+
 bool file::exist() const noexcept
 {
 	if( name_.empty() )
@@ -210,7 +221,7 @@ s_read_channel file::open_for_read(std::error_code& ec) const noexcept
 	return nullptr != ch ? s_read_channel( ch ) : s_read_channel();
 }
 
-s_write_channel file::open_for_write(std::error_code& ec,write_open_mode mode) const noexcept
+s_write_channel file::open_for_write(std::error_code& ec,write_open_mode mode, write_durability durability) const noexcept
 {
 	if( name_.empty() ) {
 		ec = std::make_error_code(std::errc::no_such_file_or_directory);
@@ -221,7 +232,7 @@ s_write_channel file::open_for_write(std::error_code& ec,write_open_mode mode) c
 					   GENERIC_WRITE, FILE_SHARE_READ,
 					   nullptr,
 					   static_cast<::DWORD>(mode),
-					   FILE_ATTRIBUTE_NORMAL, 0);
+					   durability_flags(durability), 0);
 	if(INVALID_HANDLE_VALUE == hnd) {
 		ec.assign( ::GetLastError(), std::system_category() );
 		return s_write_channel();
@@ -230,7 +241,7 @@ s_write_channel file::open_for_write(std::error_code& ec,write_open_mode mode) c
 	return nullptr != ch ? s_write_channel( ch ) : s_write_channel();
 }
 
-s_random_access_channel file::open_for_random_access(std::error_code& ec,write_open_mode mode) const noexcept
+s_random_access_channel file::open_for_random_access(std::error_code& ec,write_open_mode mode, write_durability durability) const noexcept
 {
 	if( name_.empty() ) {
 		ec = std::make_error_code(std::errc::no_such_file_or_directory);
@@ -241,7 +252,7 @@ s_random_access_channel file::open_for_random_access(std::error_code& ec,write_o
 					   GENERIC_READ | GENERIC_WRITE,  FILE_SHARE_READ,
 					   nullptr,
 					   static_cast<::DWORD>(mode),
-					   FILE_ATTRIBUTE_NORMAL, 0);
+					   durability_flags(durability), 0);
 	if(INVALID_HANDLE_VALUE == hnd) {
 		ec.assign( ::GetLastError(), std::system_category() );
 		return s_random_access_channel();
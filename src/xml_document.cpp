@@ -0,0 +1,552 @@
+/*
+ *
+ * Copyright (c) 2016-2019
+ * Viktor Gubin
+ *
+ * Use, modification and distribution are subject to the
+ * Boost Software License, Version 1.0. (See accompanying file
+ * LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+#include "stdafx.hpp"
+#include "xml_document.hpp"
+#include "strings.hpp"
+
+#include <unordered_map>
+
+namespace io {
+
+namespace xml {
+
+// Growing arena block of trivial records addressed by index,
+// released at once
+template<typename T>
+class arena_array {
+	arena_array(const arena_array&) = delete;
+	arena_array& operator=(const arena_array&) = delete;
+public:
+	// indexes are 32 bit, last value is reserved for the no index marker
+	static constexpr std::size_t MAX_SIZE = UINT32_MAX - 1;
+	static constexpr std::size_t INITIAL_CAPACITY = 64;
+
+	arena_array() noexcept:
+		data_(nullptr),
+		size_(0),
+		capacity_(0)
+	{}
+
+	~arena_array() noexcept
+	{
+		if(nullptr != data_)
+			memory_traits::free(data_);
+	}
+
+	inline T* data() const noexcept {
+		return data_;
+	}
+
+	inline uint32_t size() const noexcept {
+		return static_cast<uint32_t>(size_);
+	}
+
+	// appends count records to the end of block
+	// returns address of the first appended record or nullptr when out of memory
+	T* append(std::error_code& ec, std::size_t count) noexcept
+	{
+		if( io_unlikely( count > (MAX_SIZE - size_) ) ) {
+			ec = std::make_error_code(std::errc::value_too_large);
+			return nullptr;
+		}
+		const std::size_t new_size = size_ + count;
+		if( new_size > capacity_ ) {
+			std::size_t new_capacity = (0 == capacity_) ? INITIAL_CAPACITY : capacity_;
+			while(new_capacity < new_size)
+				new_capacity <<= 1;
+			if(new_capacity > MAX_SIZE)
+				new_capacity = MAX_SIZE;
+			void* ptr = memory_traits::realloc(data_, new_capacity * sizeof(T) );
+			if( io_unlikely(nullptr == ptr) ) {
+				ec = std::make_error_code(std::errc::not_enough_memory);
+				return nullptr;
+			}
+			data_ = static_cast<T*>(ptr);
+			capacity_ = new_capacity;
+		}
+		T* ret = data_ + size_;
+		size_ = new_size;
+		return ret;
+	}
+
+	// shrinks block to the size and passes block ownership to caller
+	T* release() noexcept
+	{
+		T* ret = data_;
+		if(nullptr != ret && size_ < capacity_) {
+			void* ptr = memory_traits::realloc(ret, (0 == size_ ? 1 : size_) * sizeof(T) );
+			if(nullptr != ptr)
+				ret = static_cast<T*>(ptr);
+		}
+		data_ = nullptr;
+		size_ = 0;
+		capacity_ = 0;
+		return ret;
+	}
+
+private:
+	T* data_;
+	std::size_t size_;
+	std::size_t capacity_;
+};
+
+// Builds document records from parser events
+class document_builder {
+	document_builder(const document_builder&) = delete;
+	document_builder& operator=(const document_builder&) = delete;
+private:
+	typedef document::node_rec node_rec;
+	typedef document::attr_rec attr_rec;
+	typedef document::name_rec name_rec;
+	// maps parser symbol ids into document names indexes
+	typedef std::unordered_map<
+		symbol_id,
+		uint32_t,
+		std::hash<symbol_id>,
+		std::equal_to<symbol_id>,
+		io::h_allocator< std::pair<const symbol_id, uint32_t> > > names_map;
+public:
+	document_builder() noexcept:
+		nodes_(),
+		attrs_(),
+		names_(),
+		chars_(),
+		names_map_(),
+		current_(document::NPOS),
+		text_end_(document::NPOS)
+	{}
+
+	void build(std::error_code& ec, const s_event_stream_parser& parser) noexcept;
+
+	void release_into(std::error_code& ec, document& doc) noexcept;
+
+private:
+	uint32_t put_chars(std::error_code& ec, const char* str, std::size_t len) noexcept;
+	uint32_t intern(std::error_code& ec, const qname& name) noexcept;
+	void start_element(std::error_code& ec, const start_element_event& ev) noexcept;
+	void end_element() noexcept;
+	void characters(std::error_code& ec, const char_view& chars) noexcept;
+
+private:
+	arena_array<node_rec> nodes_;
+	arena_array<attr_rec> attrs_;
+	arena_array<name_rec> names_;
+	arena_array<char> chars_;
+	names_map names_map_;
+	// currently open element
+	uint32_t current_;
+	// characters end of the last text node, to join adjacent characters sections
+	uint32_t text_end_;
+};
+
+uint32_t document_builder::put_chars(std::error_code& ec, const char* str, std::size_t len) noexcept
+{
+	const uint32_t ret = chars_.size();
+	char* dst = chars_.append(ec, len);
+	if( io_likely(nullptr != dst) )
+		io_memmove(dst, str, len);
+	return ret;
+}
+
+uint32_t document_builder::intern(std::error_code& ec, const qname& name) noexcept
+{
+	// parser returns names without symbol only when it is out of memory
+	if( io_unlikely( NO_SYMBOL == name.id() ) ) {
+		ec = std::make_error_code(std::errc::not_enough_memory);
+		return document::NPOS;
+	}
+	names_map::const_iterator it = names_map_.find( name.id() );
+	if( names_map_.cend() != it )
+		return it->second;
+	const std::size_t prefix_len = name.prefix().size();
+	const std::size_t local_len = name.local_name().size();
+	const std::size_t len = (0 == prefix_len) ? local_len : prefix_len + 1 + local_len;
+	const uint32_t str = chars_.size();
+	char* dst = chars_.append(ec, len);
+	if(ec)
+		return document::NPOS;
+	if(0 != prefix_len) {
+		io_memmove(dst, name.prefix().data(), prefix_len);
+		dst += prefix_len;
+		*dst++ = ':';
+	}
+	io_memmove(dst, name.local_name().data(), local_len);
+	const uint32_t ret = names_.size();
+	name_rec* rec = names_.append(ec, 1);
+	if(ec)
+		return document::NPOS;
+	rec->id = name.id();
+	rec->str = str;
+	rec->len = static_cast<uint32_t>(len);
+	rec->prefix_len = static_cast<uint32_t>(prefix_len);
+#ifndef IO_NO_EXCEPTIONS
+	try {
+#endif // IO_NO_EXCEPTIONS
+		names_map_.emplace( name.id(), ret );
+#ifndef IO_NO_EXCEPTIONS
+	} catch(...) {
+		ec = std::make_error_code(std::errc::not_enough_memory);
+		return document::NPOS;
+	}
+#endif // IO_NO_EXCEPTIONS
+	return ret;
+}
+
+void document_builder::start_element(std::error_code& ec, const start_element_event& ev) noexcept
+{
+	const uint32_t name = intern(ec, ev.name() );
+	if(ec)
+		return;
+	const uint32_t first_attr = attrs_.size();
+	for(start_element_event::iterator it = ev.attr_begin(); it != ev.attr_end(); ++it) {
+		const uint32_t attr_name = intern(ec, it->name() );
+		if(ec)
+			return;
+		const const_string value = it->value();
+		const uint32_t val = put_chars(ec, value.data(), value.size() );
+		attr_rec* a = attrs_.append(ec, 1);
+		if(ec)
+			return;
+		a->id = it->name().id();
+		a->name = attr_name;
+		a->value = val;
+		a->value_len = static_cast<uint32_t>( value.size() );
+	}
+	const uint32_t idx = nodes_.size();
+	node_rec* n = nodes_.append(ec, 1);
+	if(ec)
+		return;
+	n->id = ev.name().id();
+	n->name = name;
+	n->parent = current_;
+	n->first = first_attr;
+	n->count = static_cast<uint32_t>( ev.attributes_count() );
+	if( ev.empty_element() ) {
+		n->end = idx + 1;
+	} else {
+		n->end = document::NPOS;
+		current_ = idx;
+	}
+	text_end_ = document::NPOS;
+}
+
+void document_builder::end_element() noexcept
+{
+	if( io_likely(document::NPOS != current_) ) {
+		node_rec& n = nodes_.data()[current_];
+		n.end = nodes_.size();
+		current_ = n.parent;
+	}
+	text_end_ = document::NPOS;
+}
+
+void document_builder::characters(std::error_code& ec, const char_view& chars) noexcept
+{
+	// characters outside of the root element
+	if(document::NPOS == current_ || chars.empty() )
+		return;
+	const uint32_t offset = put_chars(ec, chars.data(), chars.size() );
+	if(ec)
+		return;
+	// join with previous characters section
+	if( text_end_ == offset ) {
+		nodes_.data()[nodes_.size() - 1].count += static_cast<uint32_t>( chars.size() );
+	} else {
+		node_rec* n = nodes_.append(ec, 1);
+		if(ec)
+			return;
+		n->id = NO_SYMBOL;
+		n->name = document::NPOS;
+		n->parent = current_;
+		n->end = nodes_.size();
+		n->first = offset;
+		n->count = static_cast<uint32_t>( chars.size() );
+	}
+	text_end_ = chars_.size();
+}
+
+static bool is_blank(const char_view& chars) noexcept
+{
+	for(const char* c = chars.begin(); c < chars.end(); c++) {
+		if( !is_space(*c) )
+			return false;
+	}
+	return true;
+}
+
+void document_builder::build(std::error_code& ec, const s_event_stream_parser& parser) noexcept
+{
+	for(state_type state = parser->scan_next(); !ec && state_type::eod != state; state = parser->scan_next() ) {
+		switch(state) {
+		case state_type::initial:
+			break;
+		case state_type::event:
+			switch( parser->current_event() ) {
+			case event_type::start_document:
+				parser->parse_start_doc();
+				break;
+			case event_type::processing_instruction:
+				parser->parse_processing_instruction();
+				break;
+			case event_type::start_element: {
+				start_element_event ev = parser->parse_start_element();
+				if( !parser->is_error() )
+					start_element(ec, ev);
+			}
+			break;
+			case event_type::end_element:
+				parser->parse_end_element();
+				if( !parser->is_error() )
+					end_element();
+				break;
+			}
+			break;
+		case state_type::characters: {
+			char_view chars = parser->read_chars_view();
+			if( !parser->is_error() && !is_blank(chars) )
+				characters(ec, chars);
+		}
+		break;
+		case state_type::cdata: {
+			char_view chars = parser->read_cdata_view();
+			if( !parser->is_error() )
+				characters(ec, chars);
+		}
+		break;
+		case state_type::comment:
+			parser->skip_comment();
+			break;
+		case state_type::dtd:
+			parser->skip_dtd();
+			break;
+		case state_type::eod:
+			io_unreachable
+			break;
+		}
+	}
+	if( !ec && parser->is_error() )
+		parser->get_last_error(ec);
+	if( !ec && ( 0 == nodes_.size() || document::NPOS != current_ ) )
+		ec = std::make_error_code(error::root_element_is_unbalanced);
+}
+
+void document_builder::release_into(std::error_code& ec, document& doc) noexcept
+{
+	// names hash table with load factor not more than 1/2
+	uint32_t slots = 16;
+	while( slots < (names_.size() << 1) )
+		slots <<= 1;
+	uint32_t* index = memory_traits::malloc_array<uint32_t>(slots);
+	if( io_unlikely(nullptr == index) ) {
+		ec = std::make_error_code(std::errc::not_enough_memory);
+		return;
+	}
+	const uint32_t mask = slots - 1;
+	const name_rec* names = names_.data();
+	for(uint32_t i = 0; i < names_.size(); i++) {
+		std::size_t slot = io::hash_bytes(chars_.data() + names[i].str, names[i].len) & mask;
+		while( 0 != index[slot] )
+			slot = (slot + 1) & mask;
+		index[slot] = i + 1;
+	}
+	doc.nodes_count_ = nodes_.size();
+	doc.nodes_ = nodes_.release();
+	doc.attrs_ = attrs_.release();
+	doc.names_count_ = names_.size();
+	doc.names_ = names_.release();
+	doc.names_index_ = index;
+	doc.names_mask_ = mask;
+	doc.chars_ = chars_.release();
+}
+
+// document
+s_document document::parse(std::error_code& ec, const s_event_stream_parser& parser) noexcept
+{
+	if( io_unlikely(!parser) ) {
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return s_document();
+	}
+	document_builder builder;
+	builder.build(ec, parser);
+	if(ec)
+		return s_document();
+	document *ret = nobadalloc<document>::construct(ec);
+	if(ec)
+		return s_document();
+	s_document result(ret);
+	builder.release_into(ec, *ret);
+	return ec ? s_document() : result;
+}
+
+s_document document::parse(std::error_code& ec, s_read_channel&& src) noexcept
+{
+	s_event_stream_parser parser = event_stream_parser::open(ec, std::forward<s_read_channel>(src) );
+	return ec ? s_document() : parse(ec, parser);
+}
+
+document::document() noexcept:
+	object(),
+	nodes_(nullptr),
+	nodes_count_(0),
+	attrs_(nullptr),
+	names_(nullptr),
+	names_count_(0),
+	names_index_(nullptr),
+	names_mask_(0),
+	chars_(nullptr)
+{}
+
+document::~document() noexcept
+{
+	memory_traits::free(nodes_);
+	memory_traits::free(attrs_);
+	memory_traits::free(names_);
+	memory_traits::free(names_index_);
+	memory_traits::free(chars_);
+}
+
+char_view document::qualified_name(uint32_t name) const noexcept
+{
+	if(NPOS == name)
+		return char_view();
+	const name_rec& n = names_[name];
+	return char_view( chars_ + n.str, static_cast<std::size_t>(n.len) );
+}
+
+char_view document::name_prefix(uint32_t name) const noexcept
+{
+	if(NPOS == name)
+		return char_view();
+	const name_rec& n = names_[name];
+	return char_view( chars_ + n.str, static_cast<std::size_t>(n.prefix_len) );
+}
+
+char_view document::local_name(uint32_t name) const noexcept
+{
+	if(NPOS == name)
+		return char_view();
+	const name_rec& n = names_[name];
+	const uint32_t skip = (0 == n.prefix_len) ? 0 : n.prefix_len + 1;
+	return char_view( chars_ + n.str + skip, static_cast<std::size_t>(n.len - skip) );
+}
+
+symbol_id document::symbol(const char* prefix, const char* local_name) const noexcept
+{
+	if( io_unlikely(nullptr == local_name || nullptr == names_index_) )
+		return NO_SYMBOL;
+	const std::size_t prefix_len = (nullptr == prefix) ? 0 : io_strlen(prefix);
+	const std::size_t local_len = io_strlen(local_name);
+	const std::size_t len = (0 == prefix_len) ? local_len : prefix_len + 1 + local_len;
+	const char* raw = local_name;
+	if(0 != prefix_len) {
+		char* tmp = static_cast<char*>( io_alloca(len) );
+		io_memmove(tmp, prefix, prefix_len);
+		tmp[prefix_len] = ':';
+		io_memmove(tmp + prefix_len + 1, local_name, local_len);
+		raw = tmp;
+	}
+	for(std::size_t slot = io::hash_bytes(raw, len) & names_mask_; 0 != names_index_[slot]; slot = (slot + 1) & names_mask_) {
+		const name_rec& n = names_[ names_index_[slot] - 1 ];
+		if( n.len == len && n.prefix_len == prefix_len && 0 == io_memcmp(chars_ + n.str, raw, len) )
+			return n.id;
+	}
+	return NO_SYMBOL;
+}
+
+document::node document::find(symbol_id id, const node& after) const noexcept
+{
+	if( io_unlikely(NO_SYMBOL == id) )
+		return node();
+	for(uint32_t i = after ? after.idx_ + 1 : 0; i < nodes_count_; i++) {
+		if( id == nodes_[i].id )
+			return node(this, i);
+	}
+	return node();
+}
+
+// document::node
+char_view document::node::text() const noexcept
+{
+	const node_rec* n = &rec();
+	// first text child of element
+	if( NPOS != n->name ) {
+		const uint32_t end = n->end;
+		uint32_t i = idx_ + 1;
+		while( i < end && NPOS != doc_->nodes_[i].name )
+			i = doc_->nodes_[i].end;
+		if(i >= end)
+			return char_view();
+		n = doc_->nodes_ + i;
+	}
+	return char_view( doc_->chars_ + n->first, static_cast<std::size_t>(n->count) );
+}
+
+document::node document::node::parent() const noexcept
+{
+	const uint32_t p = rec().parent;
+	return NPOS == p ? node() : node(doc_, p);
+}
+
+document::node document::node::first_child() const noexcept
+{
+	const uint32_t i = idx_ + 1;
+	return i < rec().end ? node(doc_, i) : node();
+}
+
+document::node document::node::next_sibling() const noexcept
+{
+	const node_rec& n = rec();
+	if( NPOS == n.parent )
+		return node();
+	return n.end < doc_->nodes_[n.parent].end ? node(doc_, n.end) : node();
+}
+
+document::node document::node::first_child(symbol_id id) const noexcept
+{
+	if( io_unlikely(NO_SYMBOL == id) )
+		return node();
+	const uint32_t end = rec().end;
+	for(uint32_t i = idx_ + 1; i < end; i = doc_->nodes_[i].end) {
+		if( id == doc_->nodes_[i].id )
+			return node(doc_, i);
+	}
+	return node();
+}
+
+document::node document::node::next_sibling(symbol_id id) const noexcept
+{
+	const node_rec& n = rec();
+	if( io_unlikely(NO_SYMBOL == id) || NPOS == n.parent )
+		return node();
+	const uint32_t end = doc_->nodes_[n.parent].end;
+	for(uint32_t i = n.end; i < end; i = doc_->nodes_[i].end) {
+		if( id == doc_->nodes_[i].id )
+			return node(doc_, i);
+	}
+	return node();
+}
+
+document::node_attribute document::node::attribute(symbol_id id) const noexcept
+{
+	const node_rec& n = rec();
+	if( NPOS == n.name )
+		return node_attribute();
+	const uint32_t end = n.first + n.count;
+	for(uint32_t i = n.first; i < end; i++) {
+		if( id == doc_->attrs_[i].id )
+			return node_attribute(doc_, i);
+	}
+	return node_attribute();
+}
+
+} // namespace xml
+
+} // namespace io
@@ -22,43 +22,114 @@ attribute::~attribute() noexcept
 //start_element_event
 start_element_event::start_element_event() noexcept:
 	name_(),
-	attributes_(),
+	attrs_(inline_attrs_),
+	size_(0),
+	capacity_(INLINE_ATTRIBUTES),
+	inline_attrs_(),
 	empty_element_(false)
 {
 }
 
 start_element_event::start_element_event(start_element_event&& rhs) noexcept:
-	name_( std::move(rhs.name_) ),
-	attributes_( std::move(rhs.attributes_) ),
-	empty_element_(rhs.empty_element_)
-{}
+	start_element_event()
+{
+	swap(rhs);
+}
 
 start_element_event::start_element_event(qname&& name, bool empty_element) noexcept:
 	name_(std::forward<qname>(name)),
-	attributes_(),
+	attrs_(inline_attrs_),
+	size_(0),
+	capacity_(INLINE_ATTRIBUTES),
+	inline_attrs_(),
 	empty_element_(empty_element)
 {}
 
-bool start_element_event::add_attribute(attribute&& attr) noexcept
+start_element_event::~start_element_event() noexcept
 {
-#ifndef IO_NO_EXCEPTIONS
-	try {
-		return attributes_.emplace( std::forward<attribute>( attr )  ).second;
-	} catch(...) {
+	if( !is_inline() )
+		delete [] attrs_;
+}
+
+void start_element_event::swap(start_element_event& other) noexcept
+{
+	name_.swap(other.name_);
+	const bool lhs_inline = is_inline();
+	const bool rhs_inline = other.is_inline();
+	// inline attributes swapping is cheap, since only string references swapped
+	for(std::size_t i = 0; i < INLINE_ATTRIBUTES; i++)
+		inline_attrs_[i].swap( other.inline_attrs_[i] );
+	std::swap(attrs_, other.attrs_);
+	std::swap(size_, other.size_);
+	std::swap(capacity_, other.capacity_);
+	if(lhs_inline)
+		other.attrs_ = other.inline_attrs_;
+	if(rhs_inline)
+		attrs_ = inline_attrs_;
+	std::swap(empty_element_, other.empty_element_);
+}
+
+bool start_element_event::grow() noexcept
+{
+	const std::size_t new_capacity = capacity_ << 1;
+	attribute* tmp = new (std::nothrow) attribute[new_capacity];
+	if( io_unlikely(nullptr == tmp) )
 		return false;
+	for(std::size_t i = 0; i < size_; i++)
+		tmp[i].swap( attrs_[i] );
+	if( !is_inline() )
+		delete [] attrs_;
+	attrs_ = tmp;
+	capacity_ = new_capacity;
+	return true;
+}
+
+// lexicographical strings order, shorter string goes first when it is a prefix of longer one
+static int compare_names(const cached_string& lhs, const cached_string& rhs) noexcept
+{
+	const std::size_t lsize = lhs.size();
+	const std::size_t rsize = rhs.size();
+	const std::size_t common = lsize < rsize ? lsize : rsize;
+	const int ret = (0 == common) ? 0 : io_memcmp( lhs.data(), rhs.data(), common );
+	if( 0 != ret )
+		return ret;
+	return (lsize < rsize) ? -1 : ( (lsize > rsize) ? 1 : 0 );
+}
+
+// orders qualified names by prefix and then by local name
+static int compare_qnames(const qname& lhs, const qname& rhs) noexcept
+{
+	const int ret = compare_names( lhs.prefix(), rhs.prefix() );
+	return (0 != ret) ? ret : compare_names( lhs.local_name(), rhs.local_name() );
+}
+
+bool start_element_event::add_attribute(attribute&& attr) noexcept
+{
+	// keep attributes sorted by name, duplicates are detected on the same pass
+	std::size_t pos = 0;
+	for(; pos < size_; pos++) {
+		const int cmp = compare_qnames( attr.name(), attrs_[pos].name() );
+		if( 0 == cmp )
+			return false;
+		else if( cmp < 0 )
+			break;
 	}
-#else
-	return attributes_.emplace( std::forward<attribute>( attr )  ).second;
-#endif // IO_NO_EXCEPTIONS
+	if( size_ == capacity_ && !grow() )
+		return false;
+	for(std::size_t i = size_; i > pos; i--)
+		attrs_[i].swap( attrs_[i-1] );
+	attrs_[pos] = std::forward<attribute>(attr);
+	++size_;
+	return true;
 }
 
 std::pair<const_string, bool> start_element_event::get_attribute(const char* prefix, const char* name) const noexcept
 {
-	iterator ret = std::find_if(attributes_.cbegin(), attributes_.cend(),
+	iterator ret = std::find_if(attr_begin(), attr_end(),
 				[prefix,name] (const attribute& attr) noexcept {
 								return attr.name().equal(prefix, name);
 				} );
-	if( attributes_.cend() != ret)
+	if( attr_end() != ret)
 		return std::make_pair( ret->value(), true );
 	else
 		return std::make_pair( const_string(), false );
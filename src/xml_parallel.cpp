@@ -0,0 +1,525 @@
+/*
+ *
+ * Copyright (c) 2016-2019
+ * Viktor Gubin
+ *
+ * Use, modification and distribution are subject to the
+ * Boost Software License, Version 1.0. (See accompanying file
+ * LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+#include "stdafx.hpp"
+#include "xml_parallel.hpp"
+#include "threading.hpp"
+#include "simd.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace io {
+
+namespace xml {
+
+// synthetic root element of the chunks following the first one,
+// so that chunk records are siblings on the first nesting level
+static const char* CHUNK_ROOT = "<_>";
+static constexpr std::size_t CHUNK_ROOT_LEN = 3;
+static constexpr std::size_t CHUNK_RECORDS_DEPTH = 1;
+static constexpr std::size_t UNKNOWN_DEPTH = static_cast<std::size_t>(-1);
+
+// Non owning view channel over a document chunk, with optional synthetic root start tag before the chunk data
+class chunk_channel final: public view_read_channel {
+public:
+	chunk_channel(const uint8_t* prefix, std::size_t prefix_len, const uint8_t* begin, const uint8_t* end) noexcept:
+		view_read_channel(),
+		pos_(begin),
+		end_(end),
+		prefix_(prefix),
+		prefix_end_(prefix + prefix_len),
+		exhausted_(false)
+	{}
+
+	virtual ~chunk_channel() noexcept override
+	{}
+
+	virtual std::size_t read(std::error_code& ec,uint8_t* const buff, std::size_t bytes) const noexcept override
+	{
+		read_view v = fill(ec);
+		const std::size_t ret = v.size() < bytes ? v.size() : bytes;
+		io_memmove(buff, v.begin(), ret);
+		consume(ret);
+		return ret;
+	}
+
+	virtual read_view fill(std::error_code&) const noexcept override
+	{
+		if(prefix_ < prefix_end_)
+			return read_view(prefix_, prefix_end_);
+		if(pos_ == end_) {
+			exhausted_ = true;
+			return read_view();
+		}
+		return read_view(pos_, end_);
+	}
+
+	virtual void consume(std::size_t bytes) const noexcept override
+	{
+		if(prefix_ < prefix_end_)
+			prefix_ += bytes;
+		else
+			pos_ += bytes;
+	}
+
+	// whether parser requested data after the chunk end
+	inline bool exhausted() const noexcept {
+		return exhausted_;
+	}
+
+private:
+	mutable const uint8_t* pos_;
+	const uint8_t* end_;
+	mutable const uint8_t* prefix_;
+	const uint8_t* prefix_end_;
+	mutable bool exhausted_;
+};
+
+typedef boost::intrusive_ptr<chunk_channel> s_chunk_channel;
+
+// finds record start tag i.e. <record followed by a white space, '>' or '/'
+static const uint8_t* find_record(const uint8_t* b, const uint8_t* e, const const_string& record) noexcept
+{
+	const char* e_ch = reinterpret_cast<const char*>(e);
+	const std::size_t len = record.size();
+	for(const char* p = reinterpret_cast<const char*>(b); p < e_ch; p++) {
+		p = simd::find(p, e_ch, '<');
+		if( memory_traits::distance(p, e_ch) <= (len + 1) )
+			break;
+		if( 0 == io_memcmp(p + 1, record.data(), len) ) {
+			const char c = p[len + 1];
+			if( is_space(c) || '>' == c || '/' == c )
+				return reinterpret_cast<const uint8_t*>(p);
+		}
+	}
+	return e;
+}
+
+// compares encoding name from XML declaration ignoring case
+static bool is_encoding(const char* enc, const char* name) noexcept
+{
+	for(; '\0' != *name; ++enc, ++name) {
+		if( io_toupper(*enc) != *name )
+			return false;
+	}
+	return '\'' == *enc || '"' == *enc;
+}
+
+// checks document is in UTF-8 or ASCII encoding, so that it can be split by raw scanning
+// and chunks are parsed without transcoding
+static bool is_splittable(const uint8_t* b, const uint8_t* e) noexcept
+{
+	const std::size_t size = memory_traits::distance(b, e);
+	// UTF-16 and UTF-32 documents are having zero bytes in the first characters
+	if( size < 4 || nullptr != io_memchr(b, 0, 4) )
+		return false;
+	const char* s = reinterpret_cast<const char*>(b);
+	if( utf8_bom::is(b) )
+		s += utf8_bom::len();
+	if( 0 != io_strncmp(s, "<?xml", 5) )
+		return true;
+	const char* decl_end = static_cast<const char*>( io_memchr(s, '>', memory_traits::distance(s, reinterpret_cast<const char*>(e)) ) );
+	if(nullptr == decl_end)
+		return false;
+	const std::size_t decl_len = memory_traits::distance(s, decl_end);
+	char* decl = static_cast<char*>( io_alloca(decl_len + 1) );
+	io_memmove(decl, s, decl_len);
+	decl[decl_len] = '\0';
+	const char* enc = io_strstr(decl, "encoding");
+	if(nullptr == enc)
+		return true;
+	enc += io_strcspn(enc, "'\"");
+	if('\0' == *enc)
+		return false;
+	++enc;
+	static const char* COMPATIBLE[] = { "UTF-8", "US-ASCII", "ASCII" };
+	for(const char* cs: COMPATIBLE) {
+		if( is_encoding(enc, cs) )
+			return true;
+	}
+	return false;
+}
+
+s_parallel_parser parallel_parser::open(std::error_code& ec, s_view_read_channel&& src, const char* record, unsigned int threads) noexcept
+{
+	if( io_unlikely(!src || nullptr == record || '\0' == *record) ) {
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return s_parallel_parser();
+	}
+	const_string name(record);
+	if( name.empty() ) {
+		ec = std::make_error_code(std::errc::not_enough_memory);
+		return s_parallel_parser();
+	}
+	if(0 == threads)
+		threads = std::thread::hardware_concurrency();
+	if(0 == threads)
+		threads = 1;
+	read_view v = src->fill(ec);
+	if(ec)
+		return s_parallel_parser();
+	std::size_t count = v.size() / MIN_CHUNK_SIZE;
+	if( count > (threads * CHUNKS_PER_THREAD) )
+		count = threads * CHUNKS_PER_THREAD;
+	if( 0 == count || !is_splittable(v.begin(), v.end()) )
+		count = 1;
+	chunks_vector chunks;
+	if( !split(ec, v.begin(), v.end(), name, count, chunks) )
+		return s_parallel_parser();
+	parallel_parser *ret = nobadalloc<parallel_parser>::construct(ec, std::move(src), std::move(chunks), std::move(name), threads);
+	return ec ? s_parallel_parser() : s_parallel_parser(ret);
+}
+
+bool parallel_parser::split(std::error_code& ec, const uint8_t* b, const uint8_t* e, const const_string& record, std::size_t count, chunks_vector& chunks) noexcept
+{
+#ifndef IO_NO_EXCEPTIONS
+	try {
+#endif // IO_NO_EXCEPTIONS
+		chunks.reserve(count);
+		chunks.push_back( chunk{ b, e, chunk_status::pending, std::error_code(), false, 0 } );
+		const std::size_t size = memory_traits::distance(b, e);
+		// the first chunk contains prologue, root element start tag and at least one record
+		const uint8_t* prev = find_record(b, e, record);
+		for(std::size_t i = 1; prev < e && i < count; i++) {
+			const uint8_t* from = b + (size / count) * i;
+			const uint8_t* split = find_record( from > prev ? from : prev + 1, e, record);
+			if(split == e)
+				break;
+			chunks.back().end = split;
+			chunks.push_back( chunk{ split, e, chunk_status::pending, std::error_code(), false, 0 } );
+			prev = split;
+		}
+#ifndef IO_NO_EXCEPTIONS
+	} catch(std::bad_alloc&) {
+		ec = std::make_error_code(std::errc::not_enough_memory);
+		return false;
+	}
+#else
+	static_cast<void>(ec);
+#endif // IO_NO_EXCEPTIONS
+	return true;
+}
+
+parallel_parser::parallel_parser(s_view_read_channel&& src, chunks_vector&& chunks, const_string&& record, unsigned int threads) noexcept:
+	object(),
+	src_( std::forward<s_view_read_channel>(src) ),
+	chunks_( std::forward<chunks_vector>(chunks) ),
+	record_( std::forward<const_string>(record) ),
+	threads_(threads)
+{}
+
+parallel_parser::~parallel_parser() noexcept
+{}
+
+// skips the rest of record content not parsed by handler, up to the record end tag
+static void finish_record(const s_event_stream_parser& parser, std::size_t depth) noexcept
+{
+	while( parser->depth() > depth && !parser->is_error() ) {
+		switch( parser->scan_next() ) {
+		case state_type::event:
+			switch( parser->current_event() ) {
+			case event_type::start_element:
+				parser->skip_subtree();
+				break;
+			case event_type::end_element:
+				parser->parse_end_element();
+				break;
+			case event_type::processing_instruction:
+				parser->parse_processing_instruction();
+				break;
+			case event_type::start_document:
+				parser->parse_start_doc();
+				break;
+			}
+			break;
+		case state_type::characters:
+			// skips the rest of current element
+			parser->skip_subtree();
+			break;
+		case state_type::cdata:
+			parser->read_cdata_view();
+			break;
+		case state_type::comment:
+			parser->skip_comment();
+			break;
+		case state_type::dtd:
+			parser->skip_dtd();
+			break;
+		case state_type::initial:
+			break;
+		case state_type::eod:
+			return;
+		}
+	}
+}
+
+parallel_parser::chunk_status parallel_parser::parse_chunk(std::size_t idx, const s_string_pool& pool, record_handler& handler) noexcept
+{
+	chunk& c = chunks_[idx];
+	handler.begin_chunk(idx);
+	std::error_code ec;
+	const bool first = (0 == idx);
+	s_chunk_channel channel( nobadalloc<chunk_channel>::construct(ec,
+								reinterpret_cast<const uint8_t*>(CHUNK_ROOT),
+								first ? 0 : CHUNK_ROOT_LEN,
+								c.begin, c.end) );
+	if(ec) {
+		c.ec = ec;
+		return chunk_status::aborted;
+	}
+	s_event_stream_parser parser = event_stream_parser::open(ec, s_view_read_channel(channel), pool);
+	if(ec) {
+		c.ec = ec;
+		return chunk_status::aborted;
+	}
+	// symbol ids are local to parser
+	symbol_id record_id;
+	const char* colon = static_cast<const char*>( io_memchr(record_.data(), ':', record_.size() ) );
+	if(nullptr == colon) {
+		record_id = parser->symbol(nullptr, record_.data() );
+	} else {
+		const_string prefix( record_.data(), colon );
+		record_id = parser->symbol(prefix.data(), colon + 1);
+	}
+	if(NO_SYMBOL == record_id) {
+		c.ec = std::make_error_code(std::errc::not_enough_memory);
+		return chunk_status::aborted;
+	}
+	// the first chunk records level is the level of the first record
+	std::size_t records_depth = first ? UNKNOWN_DEPTH : CHUNK_RECORDS_DEPTH;
+	// whether parser is inside of a record or a skipped sibling element
+	bool inside = false;
+	for(state_type state = parser->scan_next(); !ec && state_type::eod != state; state = parser->scan_next() ) {
+		switch(state) {
+		case state_type::event:
+			switch( parser->current_event() ) {
+			case event_type::start_document:
+				parser->parse_start_doc();
+				break;
+			case event_type::processing_instruction:
+				parser->parse_processing_instruction();
+				break;
+			case event_type::start_element: {
+				const std::size_t depth = parser->depth();
+				start_element_event ev = parser->parse_start_element();
+				if( parser->is_error() )
+					break;
+				inside = true;
+				if( record_id == ev.name().id() && (UNKNOWN_DEPTH == records_depth || depth == records_depth) ) {
+					records_depth = depth;
+					handler.record(ec, idx, ev, parser);
+					if(!ec)
+						finish_record(parser, depth);
+				} else if( depth == records_depth && !ev.empty_element() ) {
+					// not a record sibling
+					parser->skip_subtree();
+				}
+				inside = parser->is_error();
+			}
+			break;
+			case event_type::end_element:
+				parser->parse_end_element();
+				break;
+			}
+			break;
+		case state_type::characters:
+			parser->skip_chars();
+			break;
+		case state_type::cdata:
+			parser->read_cdata_view();
+			break;
+		case state_type::comment:
+			parser->skip_comment();
+			break;
+		case state_type::dtd:
+			parser->skip_dtd();
+			break;
+		case state_type::initial:
+		case state_type::eod:
+			break;
+		}
+	}
+	if(ec) {
+		c.ec = ec;
+		return chunk_status::aborted;
+	}
+	if( !parser->is_error() ) {
+		// root element is closed, only the last chunk can end with the document
+		if( c.end == chunks_.back().end )
+			return chunk_status::ok;
+		c.ec = make_error_code(error::root_element_is_unbalanced);
+		return chunk_status::failed;
+	}
+	parser->get_last_error(c.ec);
+	if( !channel->exhausted() )
+		return chunk_status::failed;
+	// chunk is cut between records
+	if( !inside && records_depth == parser->depth() && c.ec == make_error_code(error::root_element_is_unbalanced) ) {
+		c.ec.clear();
+		return chunk_status::ok;
+	}
+	return chunk_status::truncated;
+}
+
+// count of leading chunks which are parsed successfully, continues from already known count.
+// Chunk begin is validated only when all previous chunks are ok, since a truncated chunk
+// is merged with the following one, and they are parsed again
+std::size_t parallel_parser::validated_prefix(std::size_t from) const noexcept
+{
+	const std::size_t count = chunks_.size();
+	while( from < count && chunk_status::ok == chunks_[from].status )
+		++from;
+	return from;
+}
+
+void parallel_parser::parse_concurrent(record_handler& handler, chunks_order order) noexcept
+{
+	std::mutex mtx;
+	std::condition_variable cv;
+	std::atomic_size_t next(0);
+	std::atomic_bool stop(false);
+	std::size_t running = 0;
+	const std::size_t count = chunks_.size();
+
+	auto worker = [this, &handler, &mtx, &cv, &next, &stop, &running, count] () noexcept {
+		std::error_code ec;
+		s_string_pool pool = string_pool::create(ec);
+		if(!ec) {
+			for(std::size_t idx = next++; idx < count && !stop; idx = next++) {
+				const chunk_status status = parse_chunk(idx, pool, handler);
+				std::lock_guard<std::mutex> lock(mtx);
+				chunks_[idx].status = status;
+				cv.notify_one();
+			}
+		}
+		std::lock_guard<std::mutex> lock(mtx);
+		--running;
+		cv.notify_one();
+	};
+
+	std::vector<std::thread, h_allocator<std::thread> > pool;
+	std::vector<std::size_t, h_allocator<std::size_t> > deliver;
+	// workers are blocked on status update, until this thread waits for them
+	std::unique_lock<std::mutex> lock(mtx);
+#ifndef IO_NO_EXCEPTIONS
+	try {
+#endif // IO_NO_EXCEPTIONS
+		deliver.reserve(count);
+		const std::size_t size = threads_ < count ? threads_ : count;
+		pool.reserve(size);
+		for(std::size_t i = 0; i < size; i++) {
+			pool.emplace_back(worker);
+			++running;
+		}
+#ifndef IO_NO_EXCEPTIONS
+	} catch(std::exception&) {
+		// run on threads which were started, the rest of chunks are parsed by complete
+		if( deliver.capacity() < count )
+			stop = true;
+	}
+#endif // IO_NO_EXCEPTIONS
+	std::size_t next_delivery = 0;
+	std::size_t validated = 0;
+	while( running > 0 ) {
+		cv.wait(lock);
+		deliver.clear();
+		validated = validated_prefix(validated);
+		// stop on a parsing error in validated chunk
+		if( validated < count && chunk_status::failed == chunks_[validated].status )
+			stop = true;
+		if(chunks_order::document == order) {
+			for(; next_delivery < validated; next_delivery++)
+				deliver.push_back(next_delivery);
+		}
+		for(std::size_t i = 0; i < count && !stop; i++) {
+			const chunk& c = chunks_[i];
+			// stop on the records handler error
+			if( chunk_status::aborted == c.status )
+				stop = true;
+			else if( chunks_order::unordered == order && i < validated && !c.delivered )
+				deliver.push_back(i);
+		}
+		for(std::size_t i: deliver)
+			chunks_[i].delivered = true;
+		lock.unlock();
+		for(std::size_t i: deliver)
+			handler.end_chunk(i);
+		lock.lock();
+	}
+	lock.unlock();
+	for(std::thread& th: pool)
+		th.join();
+}
+
+// parses chunks which were not parsed or which splits were wrong, and delivers the rest of chunks in document order
+void parallel_parser::complete(std::error_code& ec, record_handler& handler) noexcept
+{
+	s_string_pool pool = string_pool::create(ec);
+	if(ec)
+		return;
+	const std::size_t count = chunks_.size();
+	for(std::size_t i = 0; i < count; i++) {
+		chunk& c = chunks_[i];
+		if(chunk_status::merged == c.status)
+			continue;
+		if(chunk_status::pending == c.status)
+			c.status = parse_chunk(i, pool, handler);
+		while(chunk_status::truncated == c.status) {
+			std::size_t j = i + 1;
+			while(j < count && chunk_status::merged == chunks_[j].status)
+				++j;
+			// chunk is not closed at the end of document
+			if(j == count)
+				break;
+			// merge with the next chunk, then fall back to parsing the rest of document as a single chunk
+			if(0 == c.merges++) {
+				c.end = chunks_[j].end;
+				chunks_[j].status = chunk_status::merged;
+			} else {
+				c.end = chunks_[count - 1].end;
+				for(; j < count; j++)
+					chunks_[j].status = chunk_status::merged;
+			}
+			c.status = parse_chunk(i, pool, handler);
+		}
+		if(chunk_status::ok != c.status) {
+			ec = c.ec;
+			return;
+		}
+		if(!c.delivered) {
+			c.delivered = true;
+			handler.end_chunk(i);
+		}
+	}
+}
+
+void parallel_parser::run(std::error_code& ec, record_handler& handler, chunks_order order) noexcept
+{
+	// restore chunks merged by previous run
+	const std::size_t count = chunks_.size();
+	for(std::size_t i = 0; i < count; i++) {
+		chunk& c = chunks_[i];
+		if( (i + 1) < count )
+			c.end = chunks_[i + 1].begin;
+		c.status = chunk_status::pending;
+		c.ec.clear();
+		c.delivered = false;
+		c.merges = 0;
+	}
+	if( threads_ > 1 && chunks_.size() > 1 )
+		parse_concurrent(handler, order);
+	complete(ec, handler);
+}
+
+} // namespace xml
+
+} // namespace io
@@ -11,6 +11,7 @@
 #include "stdafx.hpp"
 #include "xml_parse.hpp"
 #include "strings.hpp"
+#include "simd.hpp"
 
 namespace io {
 namespace xml {
@@ -192,6 +193,113 @@ static constexpr bool is_xml_name_char(char32_t ch) noexcept
 #endif // __GNUG__
 
 
+// Decodes a single predefined entity i.e. &amp; &lt; &gt; &quot; &apos;
+// or numeric character reference i.e. &#NNN; &#xHHH;
+// src points on '&', reference is read before the decoded character is written
+// so that dst may point into the same buffer before src
+// returns position after the reference, or nullptr when this is not a known reference
+static const char* decode_reference(char*& dst, const char* src, const char* e) noexcept
+{
+	// &#x0010FFFF; with some leading zeros is the longest meaningful reference
+	static constexpr std::size_t MAX_REFERENCE_LEN = 16;
+	// checked after each digit, so the value never overflows
+	static constexpr uint32_t MAX_CODE_POINT = 0x10FFFF;
+	const char* lim = (memory_traits::distance(src, e) > MAX_REFERENCE_LEN) ? src + MAX_REFERENCE_LEN : e;
+	const char* sc = simd::find(src + 1, lim, ';');
+	if( lim == sc )
+		return nullptr;
+	const char* b = src + 1;
+	const std::size_t len = str_size(b, sc);
+	if( len > 1 && cheq('#', *b) ) {
+		++b;
+		uint32_t ch = 0;
+		if( cheq('x', *b) ) {
+			if( ++b == sc )
+				return nullptr;
+			for(; b < sc; b++) {
+				const char c = *b;
+				if( io_isdigit(c) )
+					ch = (ch << 4) | static_cast<uint32_t>(c - '0');
+				else if( (c >= 'a' && c <= 'f') )
+					ch = (ch << 4) | static_cast<uint32_t>(c - 'a' + 10);
+				else if( (c >= 'A' && c <= 'F') )
+					ch = (ch << 4) | static_cast<uint32_t>(c - 'A' + 10);
+				else
+					return nullptr;
+				if( ch > MAX_CODE_POINT )
+					return nullptr;
+			}
+		} else {
+			for(; b < sc; b++) {
+				if( !io_isdigit(*b) )
+					return nullptr;
+				ch = (ch * 10) + static_cast<uint32_t>(*b - '0');
+				if( ch > MAX_CODE_POINT )
+					return nullptr;
+			}
+		}
+		if( 0 == ch )
+			return nullptr;
+		char* ret = utf8::char32tomb(dst, static_cast<char32_t>(ch) );
+		if( nullptr == ret )
+			return nullptr;
+		dst = ret;
+		return sc + 1;
+	}
+	char ch;
+	switch(len) {
+	case 2:
+		if( cheq('l',b[0]) && cheq('t',b[1]) )
+			ch = '<';
+		else if( cheq('g',b[0]) && cheq('t',b[1]) )
+			ch = '>';
+		else
+			return nullptr;
+		break;
+	case 3:
+		if( 0 != io_memcmp(b, "amp", 3) )
+			return nullptr;
+		ch = '&';
+		break;
+	case 4:
+		if( 0 == io_memcmp(b, "quot", 4) )
+			ch = '"';
+		else if( 0 == io_memcmp(b, "apos", 4) )
+			ch = '\'';
+		else
+			return nullptr;
+		break;
+	default:
+		return nullptr;
+	}
+	*dst++ = ch;
+	return sc + 1;
+}
+
+// Decodes predefined entities and numeric character references in place,
+// decoded characters are always shorter then references so that the buffer never grows.
+// Unknown i.e. DTD declared entities are left as is
+// returns new range end
+static char* decode_references(char* b, char* e) noexcept
+{
+	char* dst = const_cast<char*>( simd::find(b, e, '&') );
+	const char* src = dst;
+	while(src < e) {
+		const char* next = decode_reference(dst, src, e);
+		if(nullptr == next) {
+			*dst++ = *src;
+			next = src + 1;
+		}
+		// copy characters up to the next reference
+		src = simd::find(next, e, '&');
+		const std::size_t run = str_size(next, src);
+		if(dst != next)
+			io_memmove(dst, next, run);
+		dst += run;
+	}
+	return dst;
+}
+
 // Check XML name is correct according XML syntax
 static error check_xml_name(const char* tn) noexcept
 {
@@ -243,37 +351,76 @@ static error validate_attribute_name(const char* name) noexcept
 	return check_xml_name(name);
 }
 
-// event_stream_parser
-s_event_stream_parser event_stream_parser::open(std::error_code& ec,s_source&& src) noexcept
+// basic_event_stream_parser
+template<class P>
+typename basic_event_stream_parser<P>::s_parser basic_event_stream_parser<P>::open(std::error_code& ec,s_source&& src) noexcept
 {
 	if(!src) {
 		ec = std::make_error_code( std::errc::bad_address );
-		return s_event_stream_parser();
+		return s_parser();
 	}
 	s_string_pool pool = string_pool::create(ec);
 	if(!pool)
-		return s_event_stream_parser();
-	return s_event_stream_parser( nobadalloc<event_stream_parser>::construct( ec, std::move(src), std::move(pool) ) );
+		return s_parser();
+	return s_parser( nobadalloc<basic_event_stream_parser>::construct( ec, std::move(src), std::move(pool) ) );
 }
 
-s_event_stream_parser event_stream_parser::open(std::error_code& ec,s_read_channel&& src) noexcept
+template<class P>
+typename basic_event_stream_parser<P>::s_parser basic_event_stream_parser<P>::open(std::error_code& ec,s_read_channel&& src) noexcept
 {
 	s_source xmlsrc = source::create(ec, std::forward<s_read_channel>(src) );
-	return !ec ? open(ec, std::move(xmlsrc) ) : s_event_stream_parser();
+	return !ec ? open(ec, std::move(xmlsrc) ) : s_parser();
+}
+
+template<class P>
+typename basic_event_stream_parser<P>::s_parser basic_event_stream_parser<P>::open(std::error_code& ec,s_view_read_channel&& src) noexcept
+{
+	s_source xmlsrc = source::create(ec, std::forward<s_view_read_channel>(src) );
+	return !ec ? open(ec, std::move(xmlsrc) ) : s_parser();
+}
+
+template<class P>
+typename basic_event_stream_parser<P>::s_parser basic_event_stream_parser<P>::open(std::error_code& ec,s_view_read_channel&& src, const s_string_pool& pool) noexcept
+{
+	if(!pool) {
+		ec = std::make_error_code( std::errc::bad_address );
+		return s_parser();
+	}
+	s_source xmlsrc = source::create(ec, std::forward<s_view_read_channel>(src) );
+	if(ec)
+		return s_parser();
+	return s_parser( nobadalloc<basic_event_stream_parser>::construct( ec, std::move(xmlsrc), s_string_pool(pool) ) );
 }
 
-event_stream_parser::event_stream_parser(s_source&& src, s_string_pool&& pool) noexcept:
+template<class P>
+basic_event_stream_parser<P>::basic_event_stream_parser(s_source&& src, s_string_pool&& pool) noexcept:
 	object(),
 	src_( std::forward<s_source>(src) ),
 	state_(),
 	current_(event_type::start_document),
 	pool_(std::forward<s_string_pool>(pool)),
 	validated_(),
-	nesting_(0)
+	symbols_(),
+	symbols_count_(0),
+	next_symbol_(FIRST_DYNAMIC_SYMBOL),
+	nesting_(0),
+	text_(),
+	attrs_(nullptr),
+	attrs_names_()
 {
 	constexpr std::size_t VD_INITIAL = 64;
 	validated_.reserve( VD_INITIAL );
+	start();
+}
+
+template<class P>
+basic_event_stream_parser<P>::~basic_event_stream_parser() noexcept
+{}
 
+// scans the document beginning, i.e. the first '<'
+template<class P>
+void basic_event_stream_parser<P>::start() noexcept
+{
 	// skip any leading spaces if any
 	char c;
 	do {
@@ -290,48 +437,260 @@ event_stream_parser::event_stream_parser(s_source&& src, s_string_pool&& pool) n
 	}
 }
 
-event_stream_parser::~event_stream_parser() noexcept
-{}
+// string pool, registered symbols and names validation cache are kept warm for the next document
+template<class P>
+void basic_event_stream_parser<P>::restart(const std::error_code& ec) noexcept
+{
+	state_ = state();
+	current_ = event_type::start_document;
+	nesting_ = 0;
+	attrs_ = nullptr;
+	sb_clear();
+	drop_dynamic_symbols();
+	if(ec)
+		assign_error(error::io_error);
+	else
+		start();
+}
 
-inline void event_stream_parser::assign_error(error ec) noexcept
+template<class P>
+void basic_event_stream_parser<P>::reset(std::error_code& ec,s_source&& src) noexcept
+{
+	if(!src) {
+		ec = std::make_error_code( std::errc::bad_address );
+		return;
+	}
+	src_ = std::forward<s_source>(src);
+	restart(ec);
+}
+
+template<class P>
+void basic_event_stream_parser<P>::reset(std::error_code& ec,s_read_channel&& src) noexcept
+{
+	src_->reset(ec, std::forward<s_read_channel>(src) );
+	restart(ec);
+}
+
+template<class P>
+void basic_event_stream_parser<P>::reset(std::error_code& ec,s_view_read_channel&& src) noexcept
+{
+	src_->reset(ec, std::forward<s_view_read_channel>(src) );
+	restart(ec);
+}
+
+template<class P>
+inline void basic_event_stream_parser<P>::assign_error(error ec) noexcept
 {
 	state_.current = state_type::eod;
 	if(error::ok == state_.ec)
 		state_.ec = ec;
 }
 
-inline void event_stream_parser::putch(byte_buffer& buf, char ch) noexcept
+template<class P>
+inline void basic_event_stream_parser<P>::putch(byte_buffer& buf, char ch) noexcept
 {
 	if( io_unlikely( !buf.put(ch) && ( !buf.ln_grow() || !buf.put(ch) ) ) )
 		assign_error(error::out_of_memory);
 }
 
-cached_string event_stream_parser::precache(const char* str) noexcept
+// prepares reusable characters buffer
+template<class P>
+inline bool basic_event_stream_parser<P>::clear_text() noexcept
+{
+	if( !text_ ) {
+		text_.extend( HUGE_BUFF_SIZE );
+		if( !text_ ) {
+			assign_error(error::out_of_memory);
+			return false;
+		}
+	}
+	text_.clear();
+	return true;
+}
+
+template<class P>
+cached_string basic_event_stream_parser<P>::precache(const char* str) noexcept
 {
 	return pool_->get(str);
 }
 
+// qualified name symbols are looked up by the hash of raw name characters i.e. prefix:local_name,
+// so that known name costs a single hash and no string pool lookups.
+// Linear probing from the hash slot, returns slot of the symbol or the first free slot
+template<class P>
+std::size_t basic_event_stream_parser<P>::symbol_slot(std::size_t hash, const char* prefix, std::size_t prefix_len, const char* local_name, std::size_t local_name_len) const noexcept
+{
+	const std::size_t mask = symbols_.size() - 1;
+	std::size_t i = hash & mask;
+	while( NO_SYMBOL != symbols_[i].name.id() && ( hash != symbols_[i].hash || !symbols_[i].name.equal(prefix, prefix_len, local_name, local_name_len) ) )
+		i = (i + 1) & mask;
+	return i;
+}
+
+template<class P>
+const qname* basic_event_stream_parser<P>::find_symbol(std::size_t hash, const char* prefix, std::size_t prefix_len, const char* local_name, std::size_t local_name_len) const noexcept
+{
+	if( symbols_.empty() )
+		return nullptr;
+	const symbol_entry& e = symbols_[ symbol_slot(hash, prefix, prefix_len, local_name, local_name_len) ];
+	return NO_SYMBOL != e.name.id() ? std::addressof(e.name) : nullptr;
+}
+
+// moves symbols into a new table, names met in documents i.e. symbols with dynamic ids are dropped when not kept
+template<class P>
+bool basic_event_stream_parser<P>::rehash_symbols(std::size_t capacity, bool keep_dynamic) noexcept
+{
+#ifndef IO_NO_EXCEPTIONS
+	try {
+#endif // IO_NO_EXCEPTIONS
+		symbols_table table(capacity);
+		const std::size_t mask = capacity - 1;
+		std::size_t count = 0;
+		for(symbol_entry& e: symbols_) {
+			const symbol_id id = e.name.id();
+			if( NO_SYMBOL == id || (!keep_dynamic && id >= FIRST_DYNAMIC_SYMBOL) )
+				continue;
+			std::size_t i = e.hash & mask;
+			while( NO_SYMBOL != table[i].name.id() )
+				i = (i + 1) & mask;
+			table[i].hash = e.hash;
+			table[i].name = std::move(e.name);
+			++count;
+		}
+		symbols_.swap(table);
+		symbols_count_ = count;
+#ifndef IO_NO_EXCEPTIONS
+	}
+	catch(...) {
+		return false;
+	}
+#endif // IO_NO_EXCEPTIONS
+	return true;
+}
+
+// name is expected to be not in the table yet
+template<class P>
+bool basic_event_stream_parser<P>::add_symbol(std::size_t hash, const qname& name) noexcept
+{
+	// table is kept at most half full, so that probe sequences are short
+	if( (symbols_count_ << 1) >= symbols_.size() ) {
+		if( io_unlikely( !rehash_symbols( symbols_.empty() ? SYMBOLS_INITIAL_CAPACITY : symbols_.size() << 1, true ) ) )
+			return false;
+	}
+	const std::size_t mask = symbols_.size() - 1;
+	std::size_t i = hash & mask;
+	while( NO_SYMBOL != symbols_[i].name.id() )
+		i = (i + 1) & mask;
+	symbols_[i].hash = hash;
+	symbols_[i].name = name;
+	++symbols_count_;
+	return true;
+}
+
+// names met in the previous document are dropped, so that a parser reused for many documents does not grow
+template<class P>
+void basic_event_stream_parser<P>::drop_dynamic_symbols() noexcept
+{
+	if( FIRST_DYNAMIC_SYMBOL == next_symbol_ )
+		return;
+	// out of memory, keep all symbols and ids
+	if( rehash_symbols(symbols_.size(), false) )
+		next_symbol_ = FIRST_DYNAMIC_SYMBOL;
+}
+
+// prefix and local name expected to be contiguous, i.e. prefix:local_name
+template<class P>
+qname basic_event_stream_parser<P>::intern_qname(const char* prefix, std::size_t prefix_len, const char* local_name, std::size_t local_name_len) noexcept
+{
+	const char* raw = (0 == prefix_len) ? local_name : prefix;
+	const std::size_t raw_len = (0 == prefix_len) ? local_name_len : str_size(prefix, local_name + local_name_len);
+	const std::size_t hash = io::hash_bytes(raw, raw_len);
+	const qname* ret = find_symbol(hash, prefix, prefix_len, local_name, local_name_len);
+	if( nullptr != ret )
+		return *ret;
+	qname name( pool_->get(prefix, prefix_len), pool_->get(local_name, local_name_len), next_symbol_ );
+	// out of memory, return name without symbol id
+	if( !add_symbol(hash, name) )
+		return qname( name.prefix(), name.local_name() );
+	++next_symbol_;
+	return name;
+}
+
+// joins prefix:local_name into temporary buffer to hash it the same way as raw parsed names
+static std::size_t symbol_hash(const char* prefix, std::size_t prefix_len, const char* local_name, std::size_t local_name_len) noexcept
+{
+	if( 0 == prefix_len )
+		return io::hash_bytes(local_name, local_name_len);
+	const std::size_t raw_len = prefix_len + 1 + local_name_len;
+	char *raw = static_cast<char*>( io_alloca(raw_len) );
+	io_memmove(raw, prefix, prefix_len);
+	raw[prefix_len] = static_cast<char>(COLON);
+	io_memmove(raw + prefix_len + 1, local_name, local_name_len);
+	return io::hash_bytes(raw, raw_len);
+}
+
+template<class P>
+bool basic_event_stream_parser<P>::register_symbol(symbol_id id, const char* prefix, const char* local_name) noexcept
+{
+	if( io_unlikely( NO_SYMBOL == id || id >= FIRST_DYNAMIC_SYMBOL || nullptr == local_name ) )
+		return false;
+	const std::size_t prefix_len = (nullptr == prefix) ? 0 : io_strlen(prefix);
+	const std::size_t local_name_len = io_strlen(local_name);
+	if( io_unlikely( 0 == local_name_len ) )
+		return false;
+	const std::size_t hash = symbol_hash(prefix, prefix_len, local_name, local_name_len);
+	if( nullptr != find_symbol(hash, prefix, prefix_len, local_name, local_name_len) )
+		return false;
+	return add_symbol(hash, qname( pool_->get(prefix, prefix_len), pool_->get(local_name, local_name_len), id ) );
+}
+
+template<class P>
+symbol_id basic_event_stream_parser<P>::symbol(const char* prefix, const char* local_name) noexcept
+{
+	const std::size_t prefix_len = (nullptr == prefix) ? 0 : io_strlen(prefix);
+	const std::size_t local_name_len = (nullptr == local_name) ? 0 : io_strlen(local_name);
+	if( io_unlikely( 0 == local_name_len ) )
+		return NO_SYMBOL;
+	const std::size_t hash = symbol_hash(prefix, prefix_len, local_name, local_name_len);
+	const qname* ret = find_symbol(hash, prefix, prefix_len, local_name, local_name_len);
+	if( nullptr != ret )
+		return ret->id();
+	if( !add_symbol(hash, qname( pool_->get(prefix, prefix_len), pool_->get(local_name, local_name_len), next_symbol_ ) ) )
+		return NO_SYMBOL;
+	return next_symbol_++;
+}
+
+template<class P>
+symbol_id basic_event_stream_parser<P>::lookup_symbol(const char* prefix, const char* local_name) const noexcept
+{
+	const std::size_t prefix_len = (nullptr == prefix) ? 0 : io_strlen(prefix);
+	const std::size_t local_name_len = (nullptr == local_name) ? 0 : io_strlen(local_name);
+	if( io_unlikely( 0 == local_name_len ) )
+		return NO_SYMBOL;
+	const qname* ret = find_symbol( symbol_hash(prefix, prefix_len, local_name, local_name_len), prefix, prefix_len, local_name, local_name_len);
+	return nullptr != ret ? ret->id() : NO_SYMBOL;
+}
+
 
 // extract name and namespace prefix if any
-qname event_stream_parser::extract_qname(const char* from, std::size_t& len) noexcept
+template<class P>
+qname basic_event_stream_parser<P>::extract_qname(const char* from, std::size_t& len) noexcept
 {
-	cached_string prefix;
-	cached_string local_name;
 	len = 0;
 	std::size_t start = 0;
-	std::size_t count = extract_prefix( start, from );
-	if( count > 0 )
-		prefix = pool_->get( (from+start), count);
+	// without name spaces prefix:name is extracted as a local name
+	std::size_t count = P::namespaces ? extract_prefix( start, from ) : 0;
+	const char* prefix = from + start;
+	const std::size_t prefix_len = count;
 	len += start+count;
 	const char* name = from+len;
 	count = extract_local_name(start,name);
-	if(count > 0) {
-		local_name = pool_->get( (name+start), count);
-	}
-	else {
+	if( 0 == count ) {
 		assign_error(error::illegal_name);
 		return qname();
 	}
+	const char* local_name = name + start;
+	const std::size_t local_name_len = count;
 	len += start+count;
 	const char* left = from + len;
 	if( cheq(SOLIDUS,*left) ) {
@@ -340,17 +699,19 @@ qname event_stream_parser::extract_qname(const char* from, std::size_t& len) noe
 	}
 	if(cheq(RIGHTB,*left))
 		++len;
-	return qname( std::move(prefix), std::move(local_name) );
+	return intern_qname(prefix, prefix_len, local_name, local_name_len);
 }
 
-state_type event_stream_parser::scan_next() noexcept
+template<class P>
+state_type basic_event_stream_parser<P>::scan_next() noexcept
 {
 	if(state_type::eod != state_.current)
 		scan();
 	return state_.current;
 }
 
-byte_buffer event_stream_parser::read_entity() noexcept
+template<class P>
+byte_buffer basic_event_stream_parser<P>::read_entity() noexcept
 {
 	byte_buffer ret;
 	ret.extend(MEDIUM_BUFF_SIZE);
@@ -381,7 +742,8 @@ byte_buffer event_stream_parser::read_entity() noexcept
         return _EMPTY_RET_TYPE(); \
     }
 
-document_event event_stream_parser::parse_start_doc() noexcept
+template<class P>
+document_event basic_event_stream_parser<P>::parse_start_doc() noexcept
 {
 	static constexpr const char* VERSION  = "version=";
 	static constexpr const char* ENCODING = "encoding=";
@@ -488,7 +850,8 @@ document_event event_stream_parser::parse_start_doc() noexcept
 	return document_event( std::move(version), std::move(encoding), standalone);
 }
 
-instruction_event event_stream_parser::parse_processing_instruction() noexcept
+template<class P>
+instruction_event basic_event_stream_parser<P>::parse_processing_instruction() noexcept
 {
 	check_event_parser_state(event_type::processing_instruction, instruction_event)
 	byte_buffer buff = read_entity();
@@ -514,18 +877,23 @@ instruction_event event_stream_parser::parse_processing_instruction() noexcept
 	return instruction_event( std::move(target), std::move(data) );
 }
 
-void event_stream_parser::skip_dtd() noexcept
+template<class P>
+void basic_event_stream_parser<P>::skip_dtd() noexcept
 {
 	if(state_type::dtd != state_.current) {
 		assign_error(error::invalid_state);
 		return;
 	}
+	sb_clear();
 	std::size_t brackets = 1;
 	do {
-		switch( std::char_traits<char>::to_int_type( next() ) ) {
-		case EOF:
+		const int i = std::char_traits<char>::to_int_type( next() );
+		// end of stream character can not be distinguished by value
+		if( io_unlikely( src_->eof() ) ) {
 			assign_error(error::illegal_dtd);
 			break;
+		}
+		switch( i ) {
 		case LEFTB:
 			++brackets;
 			break;
@@ -539,7 +907,8 @@ void event_stream_parser::skip_dtd() noexcept
 	while( brackets > 0);
 }
 
-const_string event_stream_parser::read_dtd() noexcept
+template<class P>
+const_string basic_event_stream_parser<P>::read_dtd() noexcept
 {
 	check_state(state_type::dtd, const_string)
 	std::error_code ec;
@@ -574,7 +943,8 @@ const_string event_stream_parser::read_dtd() noexcept
 	return const_string( dtd.position().cdata(), dtd.last().cdata() );
 }
 
-void event_stream_parser::skip_comment() noexcept
+template<class P>
+void basic_event_stream_parser<P>::skip_comment() noexcept
 {
 	if(state_type::comment != state_.current) {
 		assign_error(error::invalid_state);
@@ -596,94 +966,125 @@ void event_stream_parser::skip_comment() noexcept
 		assign_error(error::illegal_commentary);
 }
 
-byte_buffer event_stream_parser::read_until_double_separator(const char separator,const error ec) noexcept
+template<class P>
+char_view basic_event_stream_parser<P>::read_until_double_separator(const char separator,const error ec) noexcept
 {
 	if( scan_failed() ) {
 		assign_error(ec);
-		return byte_buffer();
+		return char_view();
 	}
 
-	byte_buffer ret;
-	ret.extend( HUGE_BUFF_SIZE );
-	if( !ret ) {
-		assign_error(error::out_of_memory);
-		return ret;
-	}
+	if( !clear_text() )
+		return char_view();
 
 	sb_clear();
 
-	src_->read_until_double_char( ret, separator );
+	char_view ret = src_->read_view_until_double_char( text_, separator );
 
-	if( ret.empty() || chnoteq(RIGHTB, next() ) ) {
+	if( src_->eof() || chnoteq(RIGHTB, next() ) ) {
 		if( error::out_of_memory == src_->last_error() )
 			assign_error(error::out_of_memory);
 		else
 			assign_error( ec );
-		return byte_buffer();
+		return char_view();
 	}
-	ret.flip();
 	return ret;
 }
 
-const_string event_stream_parser::read_comment() noexcept
+template<class P>
+char_view basic_event_stream_parser<P>::read_comment_view() noexcept
 {
-	check_state(state_type::comment, const_string)
-	constexpr std::size_t END_LEXEM_LEN = 3; // --> len
-	byte_buffer tmp( read_until_double_separator(HYPHEN, error::illegal_commentary) );
-	if( tmp.empty() || 0 == io_strcmp("--", tmp.position().cdata() ) )
-		return  const_string();
-	else
-		return const_string( tmp.position().cdata(), tmp.last().cdata()-END_LEXEM_LEN );
+	check_state(state_type::comment, char_view)
+	return read_until_double_separator(HYPHEN, error::illegal_commentary);
 }
 
-const_string event_stream_parser::read_chars() noexcept
+template<class P>
+const_string basic_event_stream_parser<P>::read_comment() noexcept
 {
-	check_state(state_type::characters, const_string)
-	byte_buffer ret;
-	ret.extend( HUGE_BUFF_SIZE );
-	if( !ret ) {
-		assign_error(error::out_of_memory);
-		return const_string();
+	char_view ret = read_comment_view();
+	return ret.empty() ? const_string() : const_string( ret.data(), ret.size() );
+}
+
+// decodes character references in characters,
+// text without any '&' which is the common case is returned as is
+template<class P>
+char_view basic_event_stream_parser<P>::decode_text(const char_view& v) noexcept
+{
+	const char* amp = simd::find(v.begin(), v.end(), '&');
+	if( io_likely( v.end() == amp ) )
+		return v;
+	char* b = const_cast<char*>( text_.position().cdata() );
+	// characters are in the source buffer, which can not be modified
+	if( v.begin() < b || v.begin() >= (b + text_.capacity()) ) {
+		if( text_.capacity() < v.size() && !text_.extend( v.size() - text_.capacity() ) ) {
+			assign_error(error::out_of_memory);
+			return char_view();
+		}
+		b = const_cast<char*>( text_.position().cdata() );
+		io_memmove(b, v.data(), v.size() );
+	} else {
+		b = const_cast<char*>( v.data() );
 	}
+	char* e = decode_references(b, b + v.size() );
+	return char_view(b, str_size(b, e) );
+}
+
+template<class P>
+char_view basic_event_stream_parser<P>::read_chars_view() noexcept
+{
+	check_state(state_type::characters, char_view)
 	// just "\s<" in scan stack
-	//const char *i = io_strchr(scan_buf_+1, RIGHTB);
 	if( is_space(scan_buf_[0]) && cheq(scan_buf_[1],RIGHTB) ) {
 		io_memmove(scan_buf_, "<", 2);
-		return const_string(scan_buf_, 1);
+		return char_view(scan_buf_, std::size_t(1) );
 	}
+	if( !clear_text() )
+		return char_view();
 	// check for <tag></tag>
-	char c = next();
+	const char c = src_->peek();
 	if( cheq(c,LEFTB) ) {
+		next();
 		io_memmove(scan_buf_, "<", 2);
-		return const_string();
+		return char_view();
 	}
-	else
-		ret.put( c );
+	// the first character is never treated as illegal
+	if( cheq(c,RIGHTB) )
+		text_.put( next() );
 
-	src_->read_until_char(ret, '<', '>');
+	char_view ret = src_->read_view_until_char(text_, '<', '>');
 	error errc = src_->last_error();
 	if( io_unlikely( error::ok != errc  ) ) {
 		if(error::illegal_markup == errc)
 			assign_error(error::root_element_is_unbalanced);
 		else
 			assign_error( errc );
+		return char_view();
 	}
-	else if( !ret.empty() ) {
-		io_memmove(scan_buf_, "<", 2);
-		ret.flip();
-		// don't add last <
-		return const_string( ret.position().cdata(), ret.length()-1 );
-	}
-	return const_string();
+	io_memmove(scan_buf_, "<", 2);
+	return decode_text(ret);
 }
 
-void event_stream_parser::skip_chars() noexcept
+template<class P>
+const_string basic_event_stream_parser<P>::read_chars() noexcept
+{
+	char_view ret = read_chars_view();
+	return ret.empty() ? const_string() : const_string( ret.data(), ret.size() );
+}
+
+template<class P>
+void basic_event_stream_parser<P>::skip_chars() noexcept
 {
 	if(state_type::characters != state_.current) {
 		assign_error(error::invalid_state);
 		return;
 	}
 	for(int i = std::char_traits<char>::to_int_type( next() ); error_state_ok() ; i = std::char_traits<char>::to_int_type( next() ) ) {
+		// end of stream character can not be distinguished by value
+		if( io_unlikely( src_->eof() ) ) {
+			sb_clear();
+			skip_failed();
+			return;
+		}
 		switch(i) {
 		case LEFTB:
 			sb_clear();
@@ -693,49 +1094,62 @@ void event_stream_parser::skip_chars() noexcept
 			sb_clear();
 			assign_error(error::illegal_chars);
 			return;
-		case io_unlikely(EOF):
-			sb_clear();
-			assign_error(error::root_element_is_unbalanced);
-			return;
 		}
 	}
 
 }
 
-const_string event_stream_parser::read_cdata() noexcept
+template<class P>
+bool basic_event_stream_parser<P>::skip_blank_chars() noexcept
+{
+	check_state(state_type::characters, bool)
+	// characters already scanned
+	if( '\0' != scan_buf_[0] )
+		return false;
+	const char c = src_->skip_spaces();
+	if( cheq(LEFTB, c) ) {
+		next();
+		io_memmove(scan_buf_, "<", 2);
+		return true;
+	}
+	if( src_->eof() )
+		skip_failed();
+	return false;
+}
+
+template<class P>
+char_view basic_event_stream_parser<P>::read_cdata_view() noexcept
+{
+	check_state(state_type::cdata, char_view)
+	return read_until_double_separator(SRIGHTB, error::illegal_cdata_section);
+}
+
+template<class P>
+const_string basic_event_stream_parser<P>::read_cdata() noexcept
 {
-	check_state(state_type::cdata, const_string)
-	byte_buffer tmp( read_until_double_separator(SRIGHTB, error::illegal_cdata_section) );
-	tmp.flip();
-	return const_string( tmp.position().cdata(), tmp.last().cdata()-3 );
+	char_view ret = read_cdata_view();
+	return ret.empty() ? const_string() : const_string( ret.data(), ret.size() );
 }
 
-attribute event_stream_parser::extract_attribute(const char* from, std::size_t& len) noexcept
+// extracts raw attribute name and normalized value, without interning the name and copying the value
+template<class P>
+bool basic_event_stream_parser<P>::extract_attribute_view(const char* from, std::size_t& len, char_view& name, char_view& value) noexcept
 {
 	len = 0;
 	// skip lead spaces, don't copy them into name
 	const char *i = find_first_symbol(from);
 	if( nullptr == i || is_one_of(*i, SOLIDUS,RIGHTB,0) )
-		return attribute();
+		return false;
 
 	const char* start = i;
 	i = io_strchr(start, ES);
 	if( nullptr == i || !is_one_of( i[1], QNM, APH) ) {
 		assign_error(error::illegal_markup);
-		return attribute();
+		return false;
 	}
+	name = char_view(start, i);
 
 	const char val_sep = *(++i);
-
-	cached_string np;
-	cached_string ln;
-	// find prefix if any, ans split onto qualified name
-	char *tmp = strchrn( start, COLON, str_size(start,i) );
-	if(nullptr != tmp) {
-		np = pool_->get( start,  str_size(start, tmp) );
-		start = tmp + 1;
-	}
-	ln = pool_->get(start, str_size(start, i-1) );
 	// extract attribute value
 	++i; // skip ( "|' )
 	start = i;
@@ -743,7 +1157,7 @@ attribute event_stream_parser::extract_attribute(const char* from, std::size_t&
 	i = io_strchr(i, val_sep );
 	if(nullptr == i) {
 		assign_error(error::illegal_attribute);
-		return attribute();
+		return false;
 	}
 	// check for empty attribute value
 	// not valid according W3C, but can be present
@@ -752,69 +1166,108 @@ attribute event_stream_parser::extract_attribute(const char* from, std::size_t&
 	// empty value attribute, return
 	if( io_unlikely( val_size < 1 ) ) {
 		len = str_size(from, i+1);
-		return attribute( qname( std::move(np), std::move(ln) ), io::const_string() );
+		value = char_view();
+		return true;
 	}
-	const_string value(start, val_size);
+	// normalize attribute value in the entity buffer
+	// replace any white space characters to space character
+	// and decode character references according to W3C XML spec,
+	// references are decoded after normalization so that &#10; and alike are preserved
+	char *v = const_cast<char*>(start);
+	char *ve = const_cast<char*>(i);
+	for(char *c = v; c < ve; c++) {
+		switch(*c) {
+		case '\t':
+		case '\n':
+		case '\v':
+		case '\f':
+		case '\r':
+			*c = ' ';
+			break;
+		default:
+			break;
+		}
+	}
+	ve = decode_references(v, ve);
+	value = char_view(v, ve);
+	len = str_size(from, ++i);
+	return true;
+}
+
+// find prefix if any, and split raw attribute name onto qualified name
+template<class P>
+qname basic_event_stream_parser<P>::intern_attribute_name(const char_view& raw) noexcept
+{
+	const char* np = raw.data();
+	const char* start = raw.data();
+	std::size_t np_len = 0;
+	const char *tmp = P::namespaces ? static_cast<const char*>( io_memchr(start, COLON, raw.size() ) ) : nullptr;
+	if(nullptr != tmp) {
+		np_len = str_size(start, tmp);
+		start = tmp + 1;
+	}
+	return intern_qname(np, np_len, start, str_size(start, raw.end() ) );
+}
+
+template<class P>
+attribute basic_event_stream_parser<P>::extract_attribute(const char* from, std::size_t& len) noexcept
+{
+	char_view raw_name, raw_value;
+	if( !extract_attribute_view(from, len, raw_name, raw_value) )
+		return attribute();
+	qname name = intern_attribute_name(raw_name);
+	if( raw_value.empty() )
+		return attribute( std::move(name), io::const_string() );
+	const_string value( raw_value.data(), raw_value.size() );
 	if( io_unlikely( value.empty() ) ) {
 		assign_error(error::out_of_memory);
+		len = 0;
 		return attribute();
 	}
-	// normalize attribute value
-	// replace any white space characters to space character
-	// according to W3C XML spec
-	char *v = const_cast<char*>( value.data() );
-	constexpr const char* NOT_SPACE_WS = "\t\n\v\f\r";
-	do {
-	 	v += io_strcspn(v,NOT_SPACE_WS);
-	 	if( not_endl(*v) )
-        	*v = ' ';
-	} while( not_endl(*v) );
-	len = str_size(from, ++i);
-	return attribute( qname( std::move(np), std::move(ln) ), std::move(value) );
+	return attribute( std::move(name), std::move(value) );
 }
 
-bool event_stream_parser::validate_xml_name(const cached_string& str, bool attr) noexcept
+template<class P>
+bool basic_event_stream_parser<P>::validate_xml_name(const qname& name, bool attr) noexcept
 {
-	std::size_t str_hash = str.hash();
-	if( validated_.end() == validated_.find( str_hash ) ) {
-		const char *s = str.data();
-		error err;
-		if(attr)
-			err = validate_attribute_name( s );
-		else
-			err = validate_tag_name( s );
-		if(error::ok != err ) {
-			assign_error( err );
-			return false;
-		}
-		validated_.insert( str_hash );
+	if( !P::validate_names )
+		return true;
+	// each symbol is validated only once
+	const std::size_t key = (static_cast<std::size_t>( name.id() ) << 1) | (attr ? 1 : 0);
+	if( NO_SYMBOL != name.id() && validated_.end() != validated_.find( key ) )
 		return true;
+	error err = attr ? validate_attribute_name( name.local_name().data() ) : validate_tag_name( name.local_name().data() );
+	if( error::ok == err && name.has_prefix() )
+		err = attr ? validate_attribute_name( name.prefix().data() ) : validate_tag_name( name.prefix().data() );
+	if(error::ok != err ) {
+		assign_error( err );
+		return false;
 	}
+	if( NO_SYMBOL != name.id() )
+		validated_.insert( key );
 	return true;
 }
 
-inline char event_stream_parser::next() noexcept
+template<class P>
+inline char basic_event_stream_parser<P>::next() noexcept
 {
 	return src_->next();
 }
 
-bool event_stream_parser::validate_attr_name(const qname& name) noexcept
+template<class P>
+bool basic_event_stream_parser<P>::validate_attr_name(const qname& name) noexcept
 {
-	bool ret = validate_xml_name( name.local_name(), true );
-	if( ret && name.has_prefix() )
-		ret = validate_xml_name(name.prefix(), true);
-	return ret;
+	return validate_xml_name( name, true );
 }
 
-bool event_stream_parser::validate_element_name(const qname& name) noexcept
+template<class P>
+bool basic_event_stream_parser<P>::validate_element_name(const qname& name) noexcept
 {
-	bool ret = validate_xml_name( name.local_name(), false );
-	if( ret && name.has_prefix() )
-		ret = validate_xml_name(name.prefix(), false);
-	return ret;
+	return validate_xml_name( name, false );
 }
 
-start_element_event event_stream_parser::parse_start_element() noexcept
+template<class P>
+start_element_event basic_event_stream_parser<P>::parse_start_element() noexcept
 {
 	check_event_parser_state(event_type::start_element, start_element_event);
 
@@ -853,7 +1306,8 @@ start_element_event event_stream_parser::parse_start_element() noexcept
 	return error_state_ok() ?  std::move(result) : start_element_event();
 }
 
-end_element_event event_stream_parser::parse_end_element() noexcept
+template<class P>
+end_element_event basic_event_stream_parser<P>::parse_end_element() noexcept
 {
 	check_event_parser_state(event_type::end_element, end_element_event )
 	qname name;
@@ -873,7 +1327,272 @@ end_element_event event_stream_parser::parse_end_element() noexcept
 	return end_element_event( std::move(name) );
 }
 
-void event_stream_parser::s_instruction_or_prologue() noexcept
+// reads markup up to the closing '>' into the reusable characters buffer, terminated with zero
+// returns markup length, or 0 in case of error
+template<class P>
+std::size_t basic_event_stream_parser<P>::read_tag() noexcept
+{
+	if( !clear_text() )
+		return 0;
+	text_.put( scan_buf_ );
+	sb_clear();
+	src_->read_until_char( text_, static_cast<char>(RIGHTB), static_cast<char>(LEFTB) );
+	if( src_->eof() ) {
+		assign_error( src_->last_error() );
+		return 0;
+	}
+	const std::size_t ret = text_.size();
+	if( io_unlikely( 0 == ret ) ) {
+		assign_error(error::illegal_markup);
+		return 0;
+	}
+	putch(text_, '\0');
+	text_.flip();
+	return ret;
+}
+
+template<class P>
+char_view basic_event_stream_parser<P>::read_start_element_view(bool& empty_element) noexcept
+{
+	attrs_ = nullptr;
+	attrs_names_.clear();
+	check_event_parser_state(event_type::start_element, char_view);
+	const std::size_t len = read_tag();
+	if( 0 == len )
+		return char_view();
+	const char* tag = text_.position().cdata();
+	constexpr std::size_t SELF_CLOSE_LEN = 2; // len of />
+	empty_element = cheq(SOLIDUS, tag[len - SELF_CLOSE_LEN] );
+	if( !empty_element )
+		++nesting_;
+	const char* name = tag + 1;
+	const std::size_t name_len = xmlname_strspn(name);
+	if( 0 == name_len ) {
+		assign_error(error::illegal_name);
+		return char_view();
+	}
+	if( P::validate_names ) {
+		std::size_t qlen = 0;
+		qname qn = extract_qname(tag, qlen);
+		if( is_error() || !validate_element_name(qn) )
+			return char_view();
+	}
+	if( is_space(name[name_len]) )
+		attrs_ = name + name_len;
+	return char_view(name, name_len);
+}
+
+template<class P>
+bool basic_event_stream_parser<P>::next_attribute_view(char_view& name, char_view& value) noexcept
+{
+	if( nullptr == attrs_ || !error_state_ok() )
+		return false;
+	std::size_t len;
+	if( !extract_attribute_view(attrs_, len, name, value) ) {
+		attrs_ = nullptr;
+		return false;
+	}
+	if( P::validate_names ) {
+		const qname qn = intern_attribute_name(name);
+		if( !validate_attr_name(qn) || !add_tag_attribute(qn) ) {
+			attrs_ = nullptr;
+			return false;
+		}
+	}
+	attrs_ += len;
+	return true;
+}
+
+// double attributes with the same name check according to W3C XML spec,
+// interned names are equal when their symbols are equal
+template<class P>
+bool basic_event_stream_parser<P>::add_tag_attribute(const qname& name) noexcept
+{
+	if( io_unlikely( NO_SYMBOL == name.id() ) )
+		return !is_error();
+	for(symbol_id id: attrs_names_) {
+		if( id == name.id() ) {
+			assign_error( error::illegal_attribute );
+			return false;
+		}
+	}
+#ifndef IO_NO_EXCEPTIONS
+	try {
+#endif // IO_NO_EXCEPTIONS
+		attrs_names_.push_back( name.id() );
+#ifndef IO_NO_EXCEPTIONS
+	} catch(std::bad_alloc&) {
+		assign_error( error::out_of_memory );
+		return false;
+	}
+#endif // IO_NO_EXCEPTIONS
+	return true;
+}
+
+template<class P>
+char_view basic_event_stream_parser<P>::read_end_element_view() noexcept
+{
+	check_event_parser_state(event_type::end_element, char_view)
+	if( io_unlikely(0 == nesting_) ) {
+		assign_error(error::root_element_is_unbalanced);
+		return char_view();
+	}
+	if(0 == (--nesting_) )
+		state_.current =  state_type::eod;
+	if( 0 == read_tag() )
+		return char_view();
+	constexpr std::size_t END_TAG_START_LEN = 2; // len of </
+	const char* name = text_.position().cdata() + END_TAG_START_LEN;
+	return char_view(name, xmlname_strspn(name) );
+}
+
+// assign error of a raw scanning stopped by end of stream
+template<class P>
+void basic_event_stream_parser<P>::skip_failed() noexcept
+{
+	const error ec = src_->last_error();
+	assign_error( error::ok != ec ? ec : error::root_element_is_unbalanced );
+}
+
+// skips start tag up to the closing '>', honoring quoted attribute values
+// returns true when element has a body, false for self closed element or in case of error
+template<class P>
+bool basic_event_stream_parser<P>::skip_start_tag() noexcept
+{
+	for(;;) {
+		const char c = src_->skip_until( static_cast<char>(RIGHTB), static_cast<char>(SOLIDUS), static_cast<char>(QNM), static_cast<char>(APH) );
+		switch( std::char_traits<char>::to_int_type(c) ) {
+		case RIGHTB:
+			return true;
+		case SOLIDUS:
+			if( cheq(RIGHTB, src_->peek() ) ) {
+				next();
+				return false;
+			}
+			break;
+		case QNM:
+		case APH:
+			if( io_likely( cheq(c, src_->skip_until(c, c, c, c) ) ) )
+				break;
+			skip_failed();
+			return false;
+		default:
+			skip_failed();
+			return false;
+		}
+	}
+}
+
+// skips characters up to the terminator i.e. ?> or double separator terminator i.e. --> ]]>
+template<class P>
+bool basic_event_stream_parser<P>::skip_until_terminator(const char separator, bool twice) noexcept
+{
+	for(;;) {
+		if( !cheq(separator, src_->skip_until(separator, separator, separator, separator) ) ) {
+			skip_failed();
+			return false;
+		}
+		if( twice ) {
+			if( !cheq(separator, src_->peek() ) )
+				continue;
+			do {
+				next();
+			} while( cheq(separator, src_->peek() ) );
+		}
+		if( cheq(RIGHTB, src_->peek() ) ) {
+			next();
+			return true;
+		}
+	}
+}
+
+template<class P>
+void basic_event_stream_parser<P>::skip_subtree() noexcept
+{
+	std::size_t depth;
+	// whether markup begin is already consumed from the source
+	bool markup = false;
+	const bool start_element = state_type::event == state_.current && event_type::start_element == current_;
+	if( start_element && cheq(LEFTB, scan_buf_[0]) ) {
+		// start tag is not parsed, skip whole element
+		// nameless <> tag
+		if( cheq(RIGHTB, scan_buf_[1]) ) {
+			assign_error(error::illegal_markup);
+			return;
+		}
+		sb_clear();
+		depth = skip_start_tag() ? 1 : 0;
+	} else if( nesting_ > 0 && ( start_element || state_type::characters == state_.current ) ) {
+		// skip the rest of the current element, start tag was parsed
+		markup = cheq(LEFTB, scan_buf_[0]);
+		sb_clear();
+		depth = 1;
+		--nesting_;
+	} else {
+		assign_error(error::invalid_state);
+		return;
+	}
+	char c;
+	while( depth > 0 && error_state_ok() ) {
+		if( !markup ) {
+			// characters are not interesting, jump to the next markup
+			c = src_->skip_until( static_cast<char>(LEFTB), static_cast<char>(LEFTB), static_cast<char>(LEFTB), static_cast<char>(LEFTB) );
+			if( io_unlikely( !cheq(LEFTB, c) ) ) {
+				skip_failed();
+				break;
+			}
+		}
+		markup = false;
+		c = next();
+		switch( std::char_traits<char>::to_int_type(c) ) {
+		case SOLIDUS:
+			// </tag>
+			if( cheq(RIGHTB, src_->skip_until( static_cast<char>(RIGHTB), static_cast<char>(LEFTB), static_cast<char>(LEFTB), static_cast<char>(LEFTB) ) ) )
+				--depth;
+			else if( src_->eof() )
+				skip_failed();
+			else
+				assign_error(error::illegal_markup);
+			break;
+		case EM:
+			c = next();
+			if( cheq(HYPHEN, c) && cheq(HYPHEN, next() ) ) {
+				// <!-- -->
+				skip_until_terminator( static_cast<char>(HYPHEN), true );
+			} else if( cheq('[', c) ) {
+				// <![CDATA[ ]]>
+				scan_buf_[0] = c;
+				for(std::size_t i = 1; i < 7; i++)
+					scan_buf_[i] = next();
+				if( 0 == io_memcmp(scan_buf_, CDATA + 2, 7) )
+					skip_until_terminator( static_cast<char>(SRIGHTB), true );
+				else
+					assign_error(error::illegal_markup);
+				sb_clear();
+			} else {
+				// DTD is not allowed inside an element
+				assign_error(error::illegal_markup);
+			}
+			break;
+		case QM:
+			// <? ?>
+			skip_until_terminator( static_cast<char>(QM), false );
+			break;
+		default:
+			if( io_unlikely( is_eof(c) ) )
+				skip_failed();
+			else if( skip_start_tag() )
+				++depth;
+			break;
+		}
+	}
+	// skipped root element
+	if( error_state_ok() && 0 == nesting_ )
+		state_.current = state_type::eod;
+}
+
+template<class P>
+void basic_event_stream_parser<P>::s_instruction_or_prologue() noexcept
 {
 	if( 0 != nesting_ ) {
 		assign_error(error::illegal_markup);
@@ -902,7 +1621,8 @@ void event_stream_parser::s_instruction_or_prologue() noexcept
 	}
 }
 
-void event_stream_parser::s_comment_cdata_or_dtd() noexcept
+template<class P>
+void basic_event_stream_parser<P>::s_comment_cdata_or_dtd() noexcept
 {
 	scan_buf_[2] = next();
 	scan_buf_[3] = next();
@@ -923,14 +1643,19 @@ void event_stream_parser::s_comment_cdata_or_dtd() noexcept
 			assign_error(error::root_element_is_unbalanced);
 		else if( is_cdata(scan_buf_) )
 			state_.current = state_type::cdata;
-		else if( is_doc_type(scan_buf_) )
-			state_.current = state_type::dtd;
+		else if( is_doc_type(scan_buf_) ) {
+			if( P::dtd )
+				state_.current = state_type::dtd;
+			else
+				assign_error(error::illegal_dtd);
+		}
 		else
 			assign_error(error::illegal_markup);
 	}
 }
 
-void event_stream_parser::s_entity() noexcept
+template<class P>
+void basic_event_stream_parser<P>::s_entity() noexcept
 {
 	scan_buf_[1] = next();
 	const int second = std::char_traits<char>::to_int_type( scan_buf_[1] );
@@ -961,7 +1686,8 @@ void event_stream_parser::s_entity() noexcept
 	}
 }
 
-void event_stream_parser::scan() noexcept
+template<class P>
+void basic_event_stream_parser<P>::scan() noexcept
 {
 	switch( std::char_traits<char>::to_int_type(*scan_buf_) ) {
 	// this is entity (tag or instruction) begin
@@ -983,6 +1709,10 @@ void event_stream_parser::scan() noexcept
 	}
 }
 
+template class basic_event_stream_parser<validating_policies>;
+template class basic_event_stream_parser<trusted_policies>;
+template class basic_event_stream_parser<raw_policies>;
+
 } // namesapce xml
 
 } // namesapce io
@@ -0,0 +1,326 @@
+/*
+ *
+ * Copyright (c) 2016-2019
+ * Viktor Gubin
+ *
+ * Use, modification and distribution are subject to the
+ * Boost Software License, Version 1.0. (See accompanying file
+ * LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+#include "stdafx.hpp"
+#include "xml_push.hpp"
+#include "simd.hpp"
+
+namespace io {
+
+namespace xml {
+
+// Read channel over fed bytes, exposes only bytes of complete markup and characters
+// i.e. up to the end of the last complete tag, or up to and including the '<' which ends characters
+class feed_channel final: public read_channel {
+	feed_channel(const feed_channel&) = delete;
+	feed_channel& operator=(const feed_channel&) = delete;
+private:
+	// kind of the markup pre-scanned
+	enum class markup {
+		// characters before markup
+		none,
+		// markup begin is fed, but kind is not known yet
+		unknown,
+		tag,
+		instruction,
+		comment,
+		cdata,
+		dtd
+	};
+	static constexpr std::size_t INITIAL_CAPACITY = 1024;
+public:
+	feed_channel() noexcept:
+		read_channel(),
+		data_(nullptr),
+		capacity_(0),
+		size_(0),
+		read_(0),
+		complete_(0),
+		scan_(0),
+		markup_(markup::none),
+		begin_(0),
+		brackets_(0),
+		finished_(false)
+	{}
+
+	virtual ~feed_channel() noexcept override
+	{
+		memory_traits::free(data_);
+	}
+
+	virtual std::size_t read(std::error_code&,uint8_t* const buff, std::size_t bytes) const noexcept override
+	{
+		const std::size_t available = complete_ - read_;
+		const std::size_t ret = available < bytes ? available : bytes;
+		io_memmove(buff, data_ + read_, ret);
+		read_ += ret;
+		return ret;
+	}
+
+	bool append(const uint8_t* data, std::size_t size) noexcept;
+
+	void finish() noexcept
+	{
+		finished_ = true;
+		complete_ = size_;
+	}
+
+	inline bool finished() const noexcept {
+		return finished_;
+	}
+
+	// count of bytes read by the source
+	inline std::size_t read_count() const noexcept {
+		return read_;
+	}
+
+	// count of exposed bytes
+	inline std::size_t complete_count() const noexcept {
+		return complete_;
+	}
+
+private:
+	void compact() noexcept;
+	void prescan() noexcept;
+	bool find_terminator(const char* term, std::size_t len) noexcept;
+	bool dtd_end() noexcept;
+	bool terminated() noexcept;
+
+	uint8_t* data_;
+	std::size_t capacity_;
+	// fed bytes
+	std::size_t size_;
+	// bytes passed to source
+	mutable std::size_t read_;
+	// bytes of complete markup and characters
+	std::size_t complete_;
+	// pre-scanning position
+	std::size_t scan_;
+	// current markup kind and begin
+	markup markup_;
+	std::size_t begin_;
+	// DTD angle brackets balance
+	std::size_t brackets_;
+	bool finished_;
+};
+
+// drops bytes passed to the source, when they are taking more then half of buffer
+void feed_channel::compact() noexcept
+{
+	std::size_t drop = read_;
+	if(markup::none != markup_ && begin_ < drop)
+		drop = begin_;
+	if( drop < (capacity_ >> 1) )
+		return;
+	io_memmove(data_, data_ + drop, size_ - drop);
+	size_ -= drop;
+	read_ -= drop;
+	complete_ -= drop;
+	scan_ -= drop;
+	if(markup::none != markup_)
+		begin_ -= drop;
+}
+
+bool feed_channel::append(const uint8_t* data, std::size_t size) noexcept
+{
+	if(nullptr != data_)
+		compact();
+	if( (size_ + size) > capacity_ ) {
+		std::size_t new_capacity = (0 == capacity_) ? INITIAL_CAPACITY : capacity_;
+		while( new_capacity < (size_ + size) )
+			new_capacity <<= 1;
+		void* ptr = memory_traits::realloc(data_, new_capacity);
+		if( io_unlikely(nullptr == ptr) )
+			return false;
+		data_ = static_cast<uint8_t*>(ptr);
+		capacity_ = new_capacity;
+	}
+	io_memmove(data_ + size_, data, size);
+	size_ += size;
+	prescan();
+	return true;
+}
+
+// looks for the markup terminator like --> from the pre-scanning position,
+// moves pre-scanning position after the terminator or to the last bytes which can start it
+bool feed_channel::find_terminator(const char* term, std::size_t len) noexcept
+{
+	const char* b = reinterpret_cast<const char*>(data_ + scan_);
+	const char* e = reinterpret_cast<const char*>(data_ + size_);
+	for(const char* p = simd::find(b, e, term[len - 1]); p < e; p = simd::find(p + 1, e, term[len - 1]) ) {
+		const char* t = p - (len - 1);
+		if( t >= b && 0 == io_memcmp(t, term, len) ) {
+			scan_ = memory_traits::distance(reinterpret_cast<const char*>(data_), p) + 1;
+			return true;
+		}
+	}
+	// terminator can be cut by the end of fed bytes
+	if( (size_ - scan_) >= len )
+		scan_ = size_ - (len - 1);
+	return false;
+}
+
+// DTD ends when all nested angle brackets are closed, the same way as parser skips it
+bool feed_channel::dtd_end() noexcept
+{
+	for(; scan_ < size_; scan_++) {
+		switch( data_[scan_] ) {
+		case '<':
+			++brackets_;
+			break;
+		case '>':
+			if(0 == --brackets_) {
+				++scan_;
+				return true;
+			}
+			break;
+		}
+	}
+	return false;
+}
+
+bool feed_channel::terminated() noexcept
+{
+	switch(markup_) {
+	case markup::tag:
+		return find_terminator(">", 1);
+	case markup::instruction:
+		return find_terminator("?>", 2);
+	case markup::comment:
+		return find_terminator("-->", 3);
+	case markup::cdata:
+		return find_terminator("]]>", 3);
+	case markup::dtd:
+		return dtd_end();
+	default:
+		break;
+	}
+	return false;
+}
+
+void feed_channel::prescan() noexcept
+{
+	static const char* CDATA = "<![CDATA[";
+	static const char* DOCTYPE = "<!DOCTYPE";
+	while( scan_ < size_ ) {
+		if(markup::none == markup_) {
+			const char* b = reinterpret_cast<const char*>(data_ + scan_);
+			const char* e = reinterpret_cast<const char*>(data_ + size_);
+			const char* lt = simd::find(b, e, '<');
+			if(lt == e) {
+				scan_ = size_;
+				return;
+			}
+			begin_ = memory_traits::distance(reinterpret_cast<const char*>(data_), lt);
+			// characters are complete, including the markup start
+			complete_ = begin_ + 1;
+			scan_ = complete_;
+			markup_ = markup::unknown;
+		} else if(markup::unknown == markup_) {
+			const std::size_t fed = size_ - begin_;
+			const char* m = reinterpret_cast<const char*>(data_ + begin_);
+			if(fed < 2)
+				return;
+			if('?' == m[1]) {
+				markup_ = markup::instruction;
+				scan_ = begin_ + 2;
+			} else if('!' != m[1]) {
+				markup_ = markup::tag;
+				scan_ = begin_ + 1;
+			} else if(fed < 4) {
+				return;
+			} else if('-' == m[2] && '-' == m[3]) {
+				markup_ = markup::comment;
+				scan_ = begin_ + 4;
+			} else if(fed < 9) {
+				return;
+			} else if( 0 == io_memcmp(m, CDATA, 9) ) {
+				markup_ = markup::cdata;
+				scan_ = begin_ + 9;
+			} else if( 0 == io_memcmp(m, DOCTYPE, 9) ) {
+				markup_ = markup::dtd;
+				brackets_ = 1;
+				scan_ = begin_ + 9;
+			} else {
+				// illegal markup, parser reports it
+				markup_ = markup::tag;
+				scan_ = begin_ + 1;
+			}
+		} else if( terminated() ) {
+			complete_ = scan_;
+			markup_ = markup::none;
+		} else {
+			return;
+		}
+	}
+}
+
+// push_parser
+s_push_parser push_parser::create(std::error_code& ec) noexcept
+{
+	boost::intrusive_ptr<feed_channel> ch( nobadalloc<feed_channel>::construct(ec) );
+	if(ec)
+		return s_push_parser();
+	push_parser *ret = nobadalloc<push_parser>::construct(ec, std::move(ch) );
+	return ec ? s_push_parser() : s_push_parser(ret);
+}
+
+push_parser::push_parser(boost::intrusive_ptr<feed_channel>&& ch) noexcept:
+	object(),
+	channel_( std::forward< boost::intrusive_ptr<feed_channel> >(ch) ),
+	src_(),
+	parser_(),
+	state_(state_type::initial)
+{}
+
+push_parser::~push_parser() noexcept
+{}
+
+void push_parser::feed(std::error_code& ec, const void* data, std::size_t size) noexcept
+{
+	if( io_unlikely( channel_->finished() ) ) {
+		ec = std::make_error_code(std::errc::operation_not_permitted);
+		return;
+	}
+	if( io_unlikely( !channel_->append( static_cast<const uint8_t*>(data), size) ) )
+		ec = std::make_error_code(std::errc::not_enough_memory);
+}
+
+void push_parser::finish() noexcept
+{
+	channel_->finish();
+}
+
+bool push_parser::scan_next(std::error_code& ec) noexcept
+{
+	if(state_type::eod == state_)
+		return false;
+	if(!parser_) {
+		// character set is detected on the first complete markup
+		if( 0 == channel_->complete_count() && !channel_->finished() )
+			return false;
+		src_ = source::create(ec, s_read_channel(channel_) );
+		if(!ec)
+			parser_ = event_stream_parser::open(ec, s_source(src_) );
+		if(ec) {
+			state_ = state_type::eod;
+			return false;
+		}
+	}
+	// parser should not read after the complete data, since end of stream can not be undone
+	if( !channel_->finished() && (channel_->read_count() - src_->buffered()) >= channel_->complete_count() )
+		return false;
+	state_ = parser_->scan_next();
+	return true;
+}
+
+} // namespace xml
+
+} // namespace io
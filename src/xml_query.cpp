@@ -0,0 +1,395 @@
+/*
+ *
+ * Copyright (c) 2016-2019
+ * Viktor Gubin
+ *
+ * Use, modification and distribution are subject to the
+ * Boost Software License, Version 1.0. (See accompanying file
+ * LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+ *
+ */
+#include "stdafx.hpp"
+#include "xml_query.hpp"
+
+namespace io {
+
+namespace xml {
+
+// characters which are ending a name in query expression
+static const char* NAME_STOPS = "/[]=@'\"()* \t\r\n";
+
+// parses qualified name i.e. prefix:local_name and moves position after the name
+static bool parse_name(const char*& s, const_string& prefix, const_string& local_name) noexcept
+{
+	const std::size_t len = io_strcspn(s, NAME_STOPS);
+	if(0 == len)
+		return false;
+	const char* colon = static_cast<const char*>( io_memchr(s, ':', len) );
+	if(nullptr != colon) {
+		const std::size_t prefix_len = memory_traits::distance(s, colon);
+		if(0 == prefix_len || (prefix_len + 1) == len)
+			return false;
+		prefix = const_string(s, prefix_len);
+		local_name = const_string(colon + 1, len - prefix_len - 1);
+		if( prefix.empty() )
+			return false;
+	} else {
+		local_name = const_string(s, len);
+	}
+	s += len;
+	return !local_name.empty();
+}
+
+static bool syntax_error(std::error_code& ec) noexcept
+{
+	ec = std::make_error_code(std::errc::invalid_argument);
+	return false;
+}
+
+// resolves name into parser symbol, wildcard i.e. empty local name is resolved to NO_SYMBOL
+static bool resolve_name(const s_event_stream_parser& parser, const const_string& prefix, const const_string& local_name, symbol_id& id) noexcept
+{
+	if( local_name.empty() ) {
+		id = NO_SYMBOL;
+		return true;
+	}
+	id = parser->symbol( prefix.empty() ? nullptr : prefix.data(), local_name.data() );
+	return NO_SYMBOL != id;
+}
+
+s_query_set query_set::create(std::error_code& ec) noexcept
+{
+	query_set *ret = nobadalloc<query_set>::construct(ec);
+	return ec ? s_query_set() : s_query_set(ret);
+}
+
+query_set::query_set() noexcept:
+	object(),
+	queries_(),
+	states_(),
+	levels_(),
+	collectors_(),
+	collectors_used_(0)
+{}
+
+query_set::~query_set() noexcept
+{}
+
+bool query_set::compile(std::error_code& ec, const char* path, query& q)
+{
+	const char* s = path;
+	q.select = select_type::element;
+	if(nullptr == s || '/' != *s)
+		return syntax_error(ec);
+	while('/' == *s) {
+		++s;
+		bool descendant = false;
+		if('/' == *s) {
+			descendant = true;
+			++s;
+		}
+		// last attribute or text selection step
+		if('@' == *s) {
+			++s;
+			if( descendant || !parse_name(s, q.attr_prefix, q.attr_local_name) )
+				return syntax_error(ec);
+			q.select = select_type::attribute;
+			break;
+		} else if( 0 == io_strncmp(s, "text()", 6) ) {
+			if( descendant )
+				return syntax_error(ec);
+			s += 6;
+			q.select = select_type::text;
+			break;
+		}
+		step st;
+		st.descendant = descendant;
+		st.id = NO_SYMBOL;
+		if('*' == *s)
+			++s;
+		else if( !parse_name(s, st.prefix, st.local_name) )
+			return syntax_error(ec);
+		bool positional = false;
+		while('[' == *s) {
+			++s;
+			predicate p;
+			p.position = 0;
+			p.id = NO_SYMBOL;
+			if('@' == *s) {
+				++s;
+				if( !parse_name(s, p.prefix, p.local_name) )
+					return syntax_error(ec);
+				p.type = predicate_type::attribute_exists;
+				if('=' == *s) {
+					const char quote = *(++s);
+					if('\'' != quote && '"' != quote)
+						return syntax_error(ec);
+					const char* e = io_strchr(++s, quote);
+					if(nullptr == e)
+						return syntax_error(ec);
+					p.value = const_string(s, memory_traits::distance(s, e) );
+					p.type = predicate_type::attribute_equals;
+					s = e + 1;
+				}
+			} else if( io_isdigit(*s) && !positional ) {
+				char* e;
+				p.position = static_cast<std::size_t>( std::strtoul(s, &e, 10) );
+				if(0 == p.position)
+					return syntax_error(ec);
+				p.type = predicate_type::position;
+				positional = true;
+				s = e;
+			} else {
+				return syntax_error(ec);
+			}
+			if(']' != *s)
+				return syntax_error(ec);
+			++s;
+			st.predicates.emplace_back( std::move(p) );
+		}
+		q.steps.emplace_back( std::move(st) );
+	}
+	if('\0' != *s || q.steps.empty() )
+		return syntax_error(ec);
+	return true;
+}
+
+std::size_t query_set::add(std::error_code& ec, const char* path, const query_callback& callback) noexcept
+{
+#ifndef IO_NO_EXCEPTIONS
+	try {
+#endif // IO_NO_EXCEPTIONS
+		query q;
+		if( !compile(ec, path, q) )
+			return 0;
+		q.attr_id = NO_SYMBOL;
+		q.callback = callback;
+		queries_.emplace_back( std::move(q) );
+#ifndef IO_NO_EXCEPTIONS
+	} catch(std::bad_alloc&) {
+		ec = std::make_error_code(std::errc::not_enough_memory);
+		return 0;
+	}
+#endif // IO_NO_EXCEPTIONS
+	return queries_.size() - 1;
+}
+
+// names are matched by parser symbol ids
+bool query_set::resolve(const s_event_stream_parser& parser) noexcept
+{
+	for(query& q: queries_) {
+		for(step& st: q.steps) {
+			if( !resolve_name(parser, st.prefix, st.local_name, st.id) )
+				return false;
+			for(predicate& p: st.predicates) {
+				if( predicate_type::position != p.type && !resolve_name(parser, p.prefix, p.local_name, p.id) )
+					return false;
+			}
+		}
+		if( select_type::attribute == q.select && !resolve_name(parser, q.attr_prefix, q.attr_local_name, q.attr_id) )
+			return false;
+	}
+	return true;
+}
+
+static start_element_event::iterator find_attribute(const start_element_event& ev, symbol_id id) noexcept
+{
+	start_element_event::iterator it = ev.attr_begin();
+	for(; it != ev.attr_end(); ++it) {
+		if( id == it->name().id() )
+			break;
+	}
+	return it;
+}
+
+bool query_set::matches(const step& st, const start_element_event& ev, std::size_t& count) const noexcept
+{
+	if( NO_SYMBOL != st.id && st.id != ev.name().id() )
+		return false;
+	for(const predicate& p: st.predicates) {
+		if( predicate_type::position == p.type ) {
+			if( ++count != p.position )
+				return false;
+		} else {
+			start_element_event::iterator it = find_attribute(ev, p.id);
+			if( ev.attr_end() == it )
+				return false;
+			if( predicate_type::attribute_equals == p.type && !(it->value() == p.value) )
+				return false;
+		}
+	}
+	return true;
+}
+
+// adds state into the level started from first, unless the same state is already there
+void query_set::push_state(std::size_t first, std::size_t q, std::size_t st)
+{
+	for(std::size_t i = first; i < states_.size(); i++) {
+		if( q == states_[i].query && st == states_[i].step )
+			return;
+	}
+	states_.push_back( state{ q, st, 0 } );
+}
+
+void query_set::start_element(const s_event_stream_parser& parser)
+{
+	start_element_event ev = parser->parse_start_element();
+	if( parser->is_error() )
+		return;
+	const std::size_t parent_first = levels_.back().first;
+	const std::size_t child_first = states_.size();
+	std::size_t coll = NO_COLLECTOR;
+	for(std::size_t i = parent_first; i < child_first; i++) {
+		const state s = states_[i];
+		const query& q = queries_[s.query];
+		const step& st = q.steps[s.step];
+		// descendant step can match any child of this element as well
+		if( st.descendant )
+			push_state(child_first, s.query, s.step);
+		if( !matches(st, ev, states_[i].count) )
+			continue;
+		if( (s.step + 1) < q.steps.size() ) {
+			push_state(child_first, s.query, s.step + 1);
+			continue;
+		}
+		switch(q.select) {
+		case select_type::element:
+			q.callback(ev, char_view() );
+			break;
+		case select_type::attribute: {
+			start_element_event::iterator it = find_attribute(ev, q.attr_id);
+			if( ev.attr_end() != it ) {
+				const const_string value = it->value();
+				q.callback(ev, char_view( value.data(), value.size() ) );
+			}
+		}
+		break;
+		case select_type::text:
+			if(NO_COLLECTOR == coll) {
+				if( collectors_used_ == collectors_.size() )
+					collectors_.emplace_back();
+				coll = collectors_used_++;
+				collectors_[coll].text.clear();
+				collectors_[coll].queries.clear();
+			}
+			collectors_[coll].queries.push_back( s.query );
+			break;
+		}
+	}
+	if( ev.empty_element() ) {
+		states_.resize(child_first);
+		if(NO_COLLECTOR != coll) {
+			for(std::size_t q: collectors_[coll].queries)
+				queries_[q].callback(ev, char_view() );
+			--collectors_used_;
+		}
+	} else if( child_first == states_.size() && NO_COLLECTOR == coll ) {
+		// no query can match inside this element
+		parser->skip_subtree();
+	} else {
+		if(NO_COLLECTOR != coll)
+			collectors_[coll].element = std::move(ev);
+		levels_.push_back( level{ child_first, coll } );
+	}
+}
+
+void query_set::end_element(const s_event_stream_parser& parser)
+{
+	parser->parse_end_element();
+	if( parser->is_error() || levels_.size() < 2 )
+		return;
+	const level lv = levels_.back();
+	levels_.pop_back();
+	states_.resize(lv.first);
+	if(NO_COLLECTOR != lv.collector) {
+		const collector& c = collectors_[lv.collector];
+		const char_view text( c.text.data(), c.text.size() );
+		for(std::size_t q: c.queries)
+			queries_[q].callback(c.element, text);
+		--collectors_used_;
+	}
+}
+
+void query_set::characters(const char_view& chars)
+{
+	const std::size_t coll = levels_.back().collector;
+	if(NO_COLLECTOR != coll)
+		collectors_[coll].text.insert( collectors_[coll].text.end(), chars.begin(), chars.end() );
+}
+
+void query_set::run(std::error_code& ec, const s_event_stream_parser& parser)
+{
+	if( io_unlikely(!parser) ) {
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return;
+	}
+	if( !resolve(parser) ) {
+		ec = std::make_error_code(std::errc::not_enough_memory);
+		return;
+	}
+#ifndef IO_NO_EXCEPTIONS
+	try {
+#endif // IO_NO_EXCEPTIONS
+		states_.clear();
+		levels_.clear();
+		collectors_used_ = 0;
+		// document level, the root element is child of it
+		levels_.push_back( level{ 0, NO_COLLECTOR } );
+		for(std::size_t i = 0; i < queries_.size(); i++)
+			states_.push_back( state{ i, 0, 0 } );
+		for(state_type state = parser->scan_next(); state_type::eod != state; state = parser->scan_next() ) {
+			switch(state) {
+			case state_type::initial:
+				break;
+			case state_type::event:
+				switch( parser->current_event() ) {
+				case event_type::start_document:
+					parser->parse_start_doc();
+					break;
+				case event_type::processing_instruction:
+					parser->parse_processing_instruction();
+					break;
+				case event_type::start_element:
+					start_element(parser);
+					break;
+				case event_type::end_element:
+					end_element(parser);
+					break;
+				}
+				break;
+			case state_type::characters: {
+				char_view chars = parser->read_chars_view();
+				if( !parser->is_error() )
+					characters(chars);
+			}
+			break;
+			case state_type::cdata: {
+				char_view chars = parser->read_cdata_view();
+				if( !parser->is_error() )
+					characters(chars);
+			}
+			break;
+			case state_type::comment:
+				parser->skip_comment();
+				break;
+			case state_type::dtd:
+				parser->skip_dtd();
+				break;
+			case state_type::eod:
+				io_unreachable
+				break;
+			}
+		}
+#ifndef IO_NO_EXCEPTIONS
+	} catch(std::bad_alloc&) {
+		ec = std::make_error_code(std::errc::not_enough_memory);
+		return;
+	}
+#endif // IO_NO_EXCEPTIONS
+	if( parser->is_error() )
+		parser->get_last_error(ec);
+}
+
+} // namespace xml
+
+} // namespace io
@@ -38,7 +38,8 @@ void reader::to_next_state(std::error_code& ec) noexcept
 			parser_->skip_dtd();
 			break;
 		case state_type::characters:
-			if( !parser_->read_chars().blank() ) {
+			// formatting spaces are skipped without copying
+			if( !parser_->skip_blank_chars() && !parser_->is_error() && !parser_->read_chars().blank() ) {
 				// error non blank characters between tags
 				ec = std::make_error_code(error::invalid_state);
 			}
@@ -85,6 +86,38 @@ start_element_event reader::next_tag_begin(std::error_code& ec) noexcept
 	return start_element_event();
 }
 
+void reader::skip_element(std::error_code& ec) noexcept
+{
+	if(state_type::event != state_)
+		to_next_state(ec);
+	while( !parse_error(ec) ) {
+		switch( parser_->current_event() ) {
+		case event_type::start_element:
+			parser_->skip_subtree();
+			if( parser_->is_error() ) {
+				parser_->get_last_error(ec);
+			} else {
+				// move to the next event, so that next tag begin or end can be checked
+				state_ = parser_->scan_next();
+				if( state_type::eod != state_ && state_type::event != state_ )
+					to_next_state(ec);
+			}
+			return;
+		case event_type::end_element:
+			ec = make_error_code(error::invalid_state);
+			return;
+		case event_type::start_document:
+			parser_->parse_start_doc();
+			to_next_state(ec);
+			break;
+		case event_type::processing_instruction:
+			parser_->parse_processing_instruction();
+			to_next_state(ec);
+			break;
+		}
+	}
+}
+
 bool reader::is_tag_begin_next() noexcept
 {
 	return state_type::event == state_ && event_type::start_element == parser_->current_event();
@@ -11,6 +11,7 @@
 #include "stdafx.hpp"
 #include "xml_source.hpp"
 #include "strings.hpp"
+#include "simd.hpp"
 
 namespace io {
 
@@ -18,7 +19,6 @@ namespace xml {
 
 
 const std::size_t source::READ_BUFF_INITIAL_SIZE = memory_traits::page_size(); // 4k in most cases
-const std::size_t source::READ_BUFF_MAXIMAL_SIZE = 0x1000000; // 16 m
 
 static constexpr unsigned int ASCII_CP_CODE = 20127;
 static constexpr unsigned int ISO_LATIN1_CP_CODE = 28591;
@@ -39,8 +39,184 @@ static bool is_utf32(const uint8_t* bom)
 	return utf_32be_bom::is(bom) || utf_32le_bom::is(bom);
 }
 
+// Transcodes UTF-16, UTF-32, ISO-8859-1 and windows-1252 documents into UTF-8 without iconv.
+// Code units and surrogate pairs cut by the end of a read from the underlying channel
+// are kept in the input buffer, and transcoded with the next portion of data
+class unicode_read_channel final: public read_channel {
+	unicode_read_channel(const unicode_read_channel&) = delete;
+	unicode_read_channel& operator=(const unicode_read_channel&) = delete;
+public:
+	enum class encoding {
+		utf16le,
+		utf16be,
+		utf32le,
+		utf32be,
+		latin1,
+		cp1252
+	};
+
+	static constexpr std::size_t INPUT_BUFF_SIZE = DEFAULT_SOURCE_WINDOW;
+
+	unicode_read_channel(const s_read_channel& src, encoding enc, scoped_arr<uint8_t>&& buff) noexcept:
+		read_channel(),
+		src_(src),
+		enc_(enc),
+		buff_( std::forward< scoped_arr<uint8_t> >(buff) ),
+		pos_( buff_.get() ),
+		end_( buff_.get() ),
+		eof_(false)
+	{}
+
+	virtual ~unicode_read_channel() noexcept override
+	{}
+
+	// puts bytes already read from the underlying channel i.e. for character set detection, before the rest of document
+	void put(const uint8_t* data, std::size_t size) noexcept
+	{
+		io_memmove( const_cast<uint8_t*>(end_), data, size);
+		end_ += size;
+	}
+
+	virtual std::size_t read(std::error_code& ec,uint8_t* const buff, std::size_t bytes) const noexcept override;
+
+private:
+	// bytes enough for any whole character, i.e. surrogate pair
+	std::size_t max_char_size() const noexcept
+	{
+		return (encoding::latin1 == enc_ || encoding::cp1252 == enc_) ? 1 : 4;
+	}
+	const uint8_t* transcode(char*& to, char* const to_end, bool& malformed) const noexcept;
+	void read_more(std::error_code& ec) const noexcept;
+
+	s_read_channel src_;
+	encoding enc_;
+	scoped_arr<uint8_t> buff_;
+	// not transcoded bytes
+	mutable const uint8_t* pos_;
+	mutable const uint8_t* end_;
+	mutable bool eof_;
+};
+
+const uint8_t* unicode_read_channel::transcode(char*& to, char* const to_end, bool& malformed) const noexcept
+{
+	switch(enc_) {
+	case encoding::utf16le:
+		return simd::utf_to_utf8<2,false>(pos_, end_, to, to_end, malformed);
+	case encoding::utf16be:
+		return simd::utf_to_utf8<2,true>(pos_, end_, to, to_end, malformed);
+	case encoding::utf32le:
+		return simd::utf_to_utf8<4,false>(pos_, end_, to, to_end, malformed);
+	case encoding::utf32be:
+		return simd::utf_to_utf8<4,true>(pos_, end_, to, to_end, malformed);
+	case encoding::latin1:
+		return simd::latin1_to_utf8<false>(pos_, end_, to, to_end, malformed);
+	case encoding::cp1252:
+		return simd::latin1_to_utf8<true>(pos_, end_, to, to_end, malformed);
+	}
+	io_unreachable
+	return pos_;
+}
+
+// moves not transcoded bytes to the buffer front, and reads next portion of data after them
+void unicode_read_channel::read_more(std::error_code& ec) const noexcept
+{
+	uint8_t* b = buff_.get();
+	const std::size_t tail = memory_traits::distance(pos_, end_);
+	io_memmove(b, pos_, tail);
+	pos_ = b;
+	end_ = b + tail;
+	const std::size_t read = src_->read(ec, b + tail, buff_.len() - tail);
+	if( ec || 0 == read )
+		eof_ = true;
+	end_ += read;
+}
+
+std::size_t unicode_read_channel::read(std::error_code& ec,uint8_t* const buff, std::size_t bytes) const noexcept
+{
+	char* const begin = reinterpret_cast<char*>(buff);
+	char* to = begin;
+	char* const to_end = begin + bytes;
+	for(;;) {
+		bool malformed;
+		pos_ = transcode(to, to_end, malformed);
+		// characters before malformed are returned first, error is reported by the next read
+		if( io_unlikely(malformed) ) {
+			if( to == begin )
+				ec = make_error_code(converrc::invalid_multibyte_sequence);
+			break;
+		}
+		// something transcoded, or no room for the next character
+		if( to != begin || 0 == bytes )
+			break;
+		if( eof_ ) {
+			if( pos_ != end_ )
+				ec = make_error_code(converrc::incomplete_multibyte_sequence);
+			break;
+		}
+		// there are more bytes but next character does not fit into the destination
+		if( memory_traits::distance(pos_, end_) >= max_char_size() ) {
+			ec = make_error_code(converrc::no_buffer_space);
+			break;
+		}
+		read_more(ec);
+		if(ec)
+			break;
+	}
+	return memory_traits::distance(begin, to);
+}
+
+static bool unicode_encoding(const charset& ch, unicode_read_channel::encoding& enc) noexcept
+{
+	if( code_pages::UTF_16LE == ch )
+		enc = unicode_read_channel::encoding::utf16le;
+	else if( code_pages::UTF_16BE == ch )
+		enc = unicode_read_channel::encoding::utf16be;
+	else if( code_pages::UTF_32LE == ch )
+		enc = unicode_read_channel::encoding::utf32le;
+	else if( code_pages::UTF_32BE == ch )
+		enc = unicode_read_channel::encoding::utf32be;
+	else if( code_pages::ISO_8859_1 == ch )
+		enc = unicode_read_channel::encoding::latin1;
+	else if( code_pages::CP_1252 == ch )
+		enc = unicode_read_channel::encoding::cp1252;
+	else
+		return false;
+	return true;
+}
+
+// opens built in transcoder for UNICODE and latin1 documents, and iconv based converter for the other legacy code pages.
+// Bytes read into rb for character set detection are replaced with their UTF-8 representation
 static s_read_channel open_convert_channel(std::error_code& ec,io::byte_buffer& rb, const uint8_t* pos, const charset& ch, const s_read_channel &src) noexcept
 {
+	const uint8_t* end = rb.last().get() - 1;
+	unicode_read_channel::encoding enc;
+	if( unicode_encoding(ch, enc) ) {
+		if( 4 == ch.char_max_size() && is_utf32(pos) )
+			pos += 4;
+		else if( 2 == ch.char_max_size() && is_utf16(pos) )
+			pos += 2;
+		std::size_t size = memory_traits::distance(pos, end);
+		if( size < unicode_read_channel::INPUT_BUFF_SIZE )
+			size = unicode_read_channel::INPUT_BUFF_SIZE;
+		scoped_arr<uint8_t> buff(size);
+		if( !buff ) {
+			ec = std::make_error_code(std::errc::not_enough_memory);
+			return s_read_channel();
+		}
+		unicode_read_channel* uch = nobadalloc<unicode_read_channel>::construct(ec, src, enc, std::move(buff) );
+		if(ec)
+			return s_read_channel();
+		s_read_channel ret(uch);
+		uch->put(pos, memory_traits::distance(pos, end) );
+		rb.clear();
+		const std::size_t read = ret->read(ec, const_cast<uint8_t*>( rb.position().get() ), rb.capacity() );
+		if(ec)
+			return s_read_channel();
+		rb.move(read);
+		rb.flip();
+		return ret;
+	}
+
 	byte_buffer new_rb;
 
 	if( is_utf16(pos) )
@@ -62,60 +238,200 @@ static s_read_channel open_convert_channel(std::error_code& ec,io::byte_buffer&
 	return conv_read_channel::open(ec, src, cnv );
 }
 
+// detects UNICODE document without byte order mark by the markup start character,
+// according to the XML specification appendix F
+static bool detect_unicode_by_markup(const uint8_t* pos, std::size_t size, charset& ch) noexcept
+{
+	if(size < 4)
+		return false;
+	if( '<' == pos[0] && 0 == pos[1] ) {
+		if( 0 == pos[2] && 0 == pos[3] )
+			ch = code_pages::UTF_32LE;
+		else if( 0 != pos[2] && 0 == pos[3] )
+			ch = code_pages::UTF_16LE;
+		else
+			return false;
+	} else if( 0 == pos[0] && 0 == pos[1] && 0 == pos[2] && '<' == pos[3] ) {
+		ch = code_pages::UTF_32BE;
+	} else if( 0 == pos[0] && '<' == pos[1] && 0 == pos[2] && 0 != pos[3] ) {
+		ch = code_pages::UTF_16BE;
+	} else {
+		return false;
+	}
+	return true;
+}
+
 // source
-s_source source::open(std::error_code& ec, const s_read_channel& src, byte_buffer&& rb) noexcept
+static charset detect_charset(std::error_code& ec, const s_charset_detector& chdet, const uint8_t* pos, std::size_t size) noexcept
 {
-	uint8_t *pos  = const_cast<uint8_t*>( rb.position().get() );
-	s_charset_detector chdet = charset_detector::create(ec);
-	if(ec)
-		return s_source();
-	charset_detect_status chdetstat = chdet->detect(ec, pos, rb.size() );
+	charset ret;
+	if( detect_unicode_by_markup(pos, size, ret) )
+		return ret;
+	charset_detect_status chdetstat = chdet->detect(ec, pos, size );
 	if( ec )
-		return s_source();
+		return charset();
 	static const double CONFIDENT = 0.5F;
 	if( !chdetstat && (chdetstat.confidence() < CONFIDENT) ) {
 		ec = make_error_code(converrc::not_supported);
-		return s_source();
+		return charset();
 	}
-	charset ch = chdetstat.character_set();
-	s_read_channel text_channel;
+	return chdetstat.character_set();
+}
+
+static charset detect_charset(std::error_code& ec, const uint8_t* pos, std::size_t size) noexcept
+{
+	s_charset_detector chdet = charset_detector::create(ec);
+	return ec ? charset() : detect_charset(ec, chdet, pos, size);
+}
+
+// checks the XML declaration i.e. <?xml version="1.0" encoding="ISO-8859-1"?> names a latin1 code page,
+// and returns the named code page into ch
+static bool declared_latin1(const uint8_t* pos, std::size_t size, charset& ch) noexcept
+{
+	static constexpr std::size_t MAX_DECL_LEN = 128;
+	const char* b = reinterpret_cast<const char*>(pos);
+	if( size < 5 || 0 != io_memcmp(b, "<?xml", 5) )
+		return false;
+	const char* e = simd::find(b, b + (size < MAX_DECL_LEN ? size : MAX_DECL_LEN), '>');
+	char decl[MAX_DECL_LEN + 1];
+	char* d = decl;
+	for(; b < e; b++)
+		*d++ = static_cast<char>( io_tolower( static_cast<uint8_t>(*b) ) );
+	*d = '\0';
+	const char* s = io_strstr(decl, "encoding");
+	if( nullptr == s )
+		return false;
+	s += 8;
+	while( io_isspace(*s) || cheq('=',*s) )
+		++s;
+	const char quote = *s++;
+	if( !cheq('"',quote) && !cheq('\'',quote) )
+		return false;
+	const std::size_t len = io_strcspn(s, "\"'");
+	if( 10 == len && ( 0 == io_strncmp(s, "iso-8859-1", len) ) )
+		ch = code_pages::ISO_8859_1;
+	else if( 6 == len && 0 == io_strncmp(s, "latin1", len) )
+		ch = code_pages::ISO_8859_1;
+	else if( (12 == len && 0 == io_strncmp(s, "windows-1252", len)) || (6 == len && 0 == io_strncmp(s, "cp1252", len)) )
+		ch = code_pages::CP_1252;
+	else
+		return false;
+	return true;
+}
+
+// ASCII and UTF-8 documents are read as is, without conversion.
+// Detector reports latin1 for any document without byte order mark and with a few non ASCII characters,
+// so latin1 document is read as is only when the detection prefix is well formed UTF-8
+// and the XML declaration does not name a latin1 code page. Otherwise it is converted to UTF-8
+static bool is_utf8_text(charset& ch, const uint8_t* pos, std::size_t size) noexcept
+{
 	switch( static_cast<unsigned int>(ch.code() ) ) {
-	// UTF-8 or latin1
 	case ASCII_CP_CODE:
-	case ISO_LATIN1_CP_CODE:
-	case WINDOWS_LATIN1_CP_CODE:
 	case UTF8_CP_CODE:
+		return true;
+	case ISO_LATIN1_CP_CODE:
+	case WINDOWS_LATIN1_CP_CODE: {
+		if( declared_latin1(pos, size, ch) )
+			return false;
+		const char* b = reinterpret_cast<const char*>(pos);
+		const char* e = b + size;
+		const char* invalid = simd::utf8_validate(b, e);
+		return e == invalid || simd::is_utf8_prefix(invalid, e);
+	}
+	default:
+		return false;
+	}
+}
+
+s_source source::open(std::error_code& ec, const s_read_channel& src, byte_buffer&& rb, const source_limits& limits) noexcept
+{
+	uint8_t *pos  = const_cast<uint8_t*>( rb.position().get() );
+	charset ch = detect_charset(ec, pos, rb.size() );
+	if(ec)
+		return s_source();
+	s_read_channel text_channel;
+	if( is_utf8_text(ch, pos, rb.size() ) ) {
 		text_channel = src;
 		if( utf8_bom::is(pos) )
 			rb.shift( utf8_bom::len() );
-		break;
-	// Create converter
-	default:
+	} else {
+		// Create converter
 		text_channel = open_convert_channel(ec, rb, pos, ch, src );
 		if(ec)
 			return s_source();
 	}
-	source *sc = nobadalloc<source>::construct(ec, std::move(text_channel), std::move(rb) );
+	source *sc = nobadalloc<source>::construct(ec, std::move(text_channel), std::move(rb), limits );
 	return (nullptr == sc) ? s_source(): s_source(sc);
 }
 
-s_source source::create(std::error_code& ec,s_read_channel&& src) noexcept
+// character set detection needs at least 4 bytes i.e. UTF-32 byte order mark
+static constexpr std::size_t DETECT_MIN_SIZE = 4;
+
+// reads document prefix for the character set detection, short reads are repeated until
+// detection has enough bytes or end of stream
+static std::size_t read_prefix(std::error_code& ec, const s_read_channel& src, uint8_t* to, std::size_t size) noexcept
+{
+	std::size_t ret = 0;
+	std::size_t read;
+	do {
+		read = src->read(ec, to + ret, size - ret);
+		ret += read;
+	} while( !ec && 0 != read && ret < DETECT_MIN_SIZE );
+	return ret;
+}
+
+// limits are sanitized, so that initial buffer is never larger then window and window is never larger then memory limit
+static source_limits sanitize_limits(const source_limits& limits, std::size_t initial) noexcept
+{
+	source_limits ret = limits;
+	if(ret.window < initial)
+		ret.window = initial;
+	if(ret.memory < ret.window)
+		ret.memory = ret.window;
+	return ret;
+}
+
+s_source source::create(std::error_code& ec,s_read_channel&& src,const source_limits& limits) noexcept
 {
 	byte_buffer buff = byte_buffer::allocate(ec,READ_BUFF_INITIAL_SIZE);
 	if(ec)
 		return s_source();
 	// charge buffer to detect character set
 	uint8_t *pos = const_cast<uint8_t*>(buff.position().get());
-	size_t read = src->read(ec, pos, buff.capacity() );
+	size_t read = read_prefix(ec, src, pos, buff.capacity() );
 	if(ec)
 		return s_source();
 	buff.move(read);
 	buff.flip();
-	return open(ec, src, std::move(buff));
+	return open(ec, src, std::move(buff), sanitize_limits(limits, READ_BUFF_INITIAL_SIZE) );
 }
 
+s_source source::create(std::error_code& ec,s_view_read_channel&& src,const source_limits& limits) noexcept
+{
+	read_view v = src->fill(ec);
+	if(ec)
+		return s_source();
+	// empty document i.e. empty mapped file, there is nothing to detect or parse
+	if( v.empty() ) {
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return s_source();
+	}
+	// view is too small for the character set detection, document is read with copying
+	if( v.size() < DETECT_MIN_SIZE )
+		return create(ec, s_read_channel( std::move(src) ), limits );
+	// detect character set on the first page only
+	const std::size_t detect_size = v.size() < READ_BUFF_INITIAL_SIZE ? v.size() : READ_BUFF_INITIAL_SIZE;
+	charset ch = detect_charset(ec, v.begin(), detect_size);
+	if(ec)
+		return s_source();
+	// non UTF-8 document, should be transcoded with copying
+	if( !is_utf8_text(ch, v.begin(), detect_size) )
+		return create(ec, s_read_channel( std::move(src) ), limits );
+	source *sc = nobadalloc<source>::construct(ec, std::forward<s_view_read_channel>(src), v, sanitize_limits(limits, READ_BUFF_INITIAL_SIZE) );
+	return (nullptr == sc) ? s_source(): s_source(sc);
+}
 
-source::source(s_read_channel&& src, byte_buffer&& rb) noexcept:
+source::source(s_read_channel&& src, byte_buffer&& rb, const source_limits& limits) noexcept:
 	object(),
 	last_( error::ok ),
 	pos_(nullptr),
@@ -125,24 +441,172 @@ source::source(s_read_channel&& src, byte_buffer&& rb) noexcept:
 	src_(src),
 	// 1page is minimum
 	rb_( std::move(rb) ),
-	mb_state_( 0 )
+	vsrc_(),
+	valid_(nullptr),
+	stitch_(),
+	chdet_(),
+	base_(nullptr),
+	offset_(0),
+	limits_(limits)
 {
 	pos_ = rb_.position().cdata();
 	end_ = rb_.last().cdata();
+	base_ = pos_;
+	valid_ = pos_;
+}
+
+source::source(s_view_read_channel&& src, const read_view& v, const source_limits& limits) noexcept:
+	object(),
+	last_( error::ok ),
+	pos_(nullptr),
+	end_(nullptr),
+	row_(1),
+	col_(1),
+	src_(),
+	rb_(),
+	vsrc_( std::forward<s_view_read_channel>(src) ),
+	valid_(nullptr),
+	stitch_(),
+	chdet_(),
+	base_(nullptr),
+	offset_(0),
+	limits_(limits)
+{
+	set_view(v);
+	if( utf8_bom::is( v.begin() ) )
+		pos_ += utf8_bom::len();
+	base_ = pos_;
+	valid_ = pos_;
 }
 
 source::~source() noexcept
 {}
 
+// character set detector is created once, and reused for all next documents
+const s_charset_detector& source::detector(std::error_code& ec) noexcept
+{
+	if( !chdet_ )
+		chdet_ = charset_detector::create(ec);
+	return chdet_;
+}
+
+// returns source into initial state, buffers are kept
+void source::rewind() noexcept
+{
+	last_ = error::ok;
+	pos_ = nullptr;
+	end_ = nullptr;
+	row_ = 1;
+	col_ = 1;
+	valid_ = nullptr;
+	base_ = nullptr;
+	offset_ = 0;
+	src_.reset();
+	vsrc_.reset();
+}
+
+void source::reset(std::error_code& ec, s_read_channel&& src) noexcept
+{
+	rewind();
+	if( !rb_ ) {
+		rb_ = byte_buffer::allocate(ec, READ_BUFF_INITIAL_SIZE);
+		if(ec)
+			return;
+	}
+	// read buffer keeps the window capacity, but not a capacity grown by a huge token of the previous document
+	rb_.clear();
+	if( rb_.capacity() > limits_.window ) {
+		rb_ = byte_buffer::allocate(ec, limits_.window);
+		if(ec)
+			return;
+	}
+	size_t read = read_prefix(ec, src, const_cast<uint8_t*>( rb_.position().get() ), rb_.capacity() );
+	if(ec)
+		return;
+	rb_.move(read);
+	rb_.flip();
+	const uint8_t* pos = rb_.position().get();
+	const s_charset_detector& chdet = detector(ec);
+	if(ec)
+		return;
+	charset ch = detect_charset(ec, chdet, pos, rb_.size() );
+	if(ec)
+		return;
+	if( is_utf8_text(ch, pos, rb_.size() ) ) {
+		src_ = std::move(src);
+		if( utf8_bom::is(pos) )
+			rb_.shift( utf8_bom::len() );
+	} else {
+		src_ = open_convert_channel(ec, rb_, pos, ch, src );
+		if(ec)
+			return;
+	}
+	pos_ = rb_.position().cdata();
+	end_ = rb_.last().cdata();
+	base_ = pos_;
+	valid_ = pos_;
+}
+
+void source::reset(std::error_code& ec, s_view_read_channel&& src) noexcept
+{
+	rewind();
+	read_view v = src->fill(ec);
+	if(ec)
+		return;
+	if( v.empty() ) {
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return;
+	}
+	if( v.size() < DETECT_MIN_SIZE ) {
+		reset(ec, s_read_channel( std::move(src) ) );
+		return;
+	}
+	const std::size_t detect_size = v.size() < READ_BUFF_INITIAL_SIZE ? v.size() : READ_BUFF_INITIAL_SIZE;
+	const s_charset_detector& chdet = detector(ec);
+	if(ec)
+		return;
+	charset ch = detect_charset(ec, chdet, v.begin(), detect_size);
+	if(ec)
+		return;
+	if( !is_utf8_text(ch, v.begin(), detect_size) ) {
+		reset(ec, s_read_channel( std::move(src) ) );
+		return;
+	}
+	vsrc_ = std::move(src);
+	set_view(v);
+	if( utf8_bom::is( v.begin() ) )
+		pos_ += utf8_bom::len();
+	base_ = pos_;
+	valid_ = pos_;
+}
+
+// moves not consumed bytes of the current data block to the buffer front, and reads the next portion of data after them.
+// Buffer grows up to the window size, and beyond it up to the memory limit only when not consumed bytes,
+// i.e. a token longer then window, are taking more then half of the buffer
 error source::read_more() noexcept
 {
+	const char* tail = pos_;
+	const std::size_t tail_size = (nullptr != pos_ && (pos_ + 1) < end_) ? memory_traits::distance(pos_, end_ - 1) : 0;
 	rb_.clear();
-	if( rb_.capacity() < READ_BUFF_MAXIMAL_SIZE ) {
-		if( io_unlikely( !rb_.exp_grow() ) )
+	if( tail_size > 0 ) {
+		io_memmove( const_cast<uint8_t*>(rb_.position().get()), tail, tail_size);
+		rb_.move(tail_size);
+	}
+	if( rb_.capacity() < limits_.window || (tail_size << 1) > rb_.capacity() ) {
+		std::size_t new_capacity = rb_.capacity() << 1;
+		if( rb_.capacity() < limits_.window && new_capacity > limits_.window )
+			new_capacity = limits_.window;
+		if( new_capacity > limits_.memory )
+			new_capacity = limits_.memory;
+		if( new_capacity > rb_.capacity() ) {
+			if( io_unlikely( !rb_.extend( new_capacity - rb_.capacity() ) ) )
+				return error::out_of_memory;
+		} else if( tail_size == rb_.capacity() ) {
 			return error::out_of_memory;
+		}
 	}
 	std::error_code ec;
-	size_t read = src_->read(ec, const_cast<uint8_t*>(rb_.position().get()), rb_.capacity() );
+	size_t read = src_->read(ec, const_cast<uint8_t*>(rb_.position().get()), rb_.available() );
 	if( ec )
 		return error::io_error;
 	rb_.move(read);
@@ -150,8 +614,55 @@ error source::read_more() noexcept
 	return error::ok;
 }
 
+// slides read window over a token which is cut by the end of current data block, so that the token can be referenced in place.
+// Returns false when there is nothing more to read, i.e. end of stream or an error
+bool source::slide() noexcept
+{
+	if( vsrc_ || error::ok != last_ || pos_ == end_ )
+		return false;
+	count_position(pos_);
+	const std::size_t tail_size = memory_traits::distance(pos_, end_ - 1);
+	last_ = read_more();
+	if( io_unlikely(error::ok != last_) ) {
+		pos_ = end_;
+		return false;
+	}
+	pos_ = rb_.position().cdata();
+	end_ = rb_.last().cdata();
+	base_ = pos_;
+	valid_ = pos_;
+	return memory_traits::distance(pos_, end_ - 1) > tail_size;
+}
+
+// points source on a channel view, and marks all view bytes as read,
+// so that next channel fill provides next portion of data
+inline void source::set_view(const read_view& v) noexcept
+{
+	base_ = end_;
+	if( v.empty() ) {
+		pos_ = end_;
+	} else {
+		pos_ = reinterpret_cast<const char*>( v.begin() );
+		// last is always points to the next byte after end
+		end_ = reinterpret_cast<const char*>( v.end() ) + 1;
+		base_ = pos_;
+		vsrc_->consume( v.size() );
+	}
+	valid_ = pos_;
+}
+
 error source::charge() noexcept
 {
+	// current data block is consumed, and will be replaced
+	count_position(pos_);
+	if( vsrc_ ) {
+		std::error_code ec;
+		read_view v = vsrc_->fill(ec);
+		if( ec )
+			return error::io_error;
+		set_view(v);
+		return error::ok;
+	}
 	error ec = read_more();
 	if( io_likely( ec == error::ok && !rb_.empty()) ) {
 		pos_ = rb_.position().cdata();
@@ -159,39 +670,98 @@ error source::charge() noexcept
 	}
 	else
 		pos_ = end_;
+	base_ = pos_;
+	valid_ = pos_;
 	return ec;
 }
 
+// joins a character cut by the end of current channel view with the first bytes of next views in the stitch buffer,
+// so that the character is exposed as a single data block. Rest of the next view is exposed by the next charge
+error source::stitch() noexcept
+{
+	count_position(pos_);
+	std::size_t size = memory_traits::distance(pos_, end_ - 1);
+	io_memmove(stitch_, pos_, size);
+	const std::size_t len = utf8::mblen(stitch_);
+	std::error_code ec;
+	while(size < len) {
+		read_view v = vsrc_->fill(ec);
+		if( ec )
+			return error::io_error;
+		if( v.empty() )
+			break;
+		const std::size_t n = (len - size) < v.size() ? len - size : v.size();
+		io_memmove(stitch_ + size, v.begin(), n);
+		vsrc_->consume(n);
+		size += n;
+	}
+	pos_ = stitch_;
+	end_ = stitch_ + size + 1;
+	base_ = pos_;
+	valid_ = pos_;
+	return error::ok;
+}
+
+// validates next window of the current data block as UTF-8, after the consumed characters.
+// Next data block is charged when current block is consumed, and a character cut by the block end
+// is joined with the next block bytes. Returns error when a malformed character is at the current position
+error source::validate() noexcept
+{
+	for(;;) {
+		if( pos_ == end_ )
+			return error::ok;
+		const char* data_end = end_ - 1;
+		if( pos_ == data_end ) {
+			const error ec = charge();
+			if( error::ok != ec )
+				return ec;
+			continue;
+		}
+		const char* e = memory_traits::distance(pos_, data_end) > limits_.window ? pos_ + limits_.window : data_end;
+		valid_ = simd::utf8_validate(pos_, e);
+		if( io_likely(valid_ != pos_) )
+			return error::ok;
+		if( !simd::is_utf8_prefix(pos_, data_end) )
+			return error::illegal_chars;
+		// character is cut by the end of data block, read channel data is moved with the not consumed tail
+		const std::size_t cut = memory_traits::distance(pos_, data_end);
+		const error ec = vsrc_ ? stitch() : charge();
+		if( error::ok != ec )
+			return ec;
+		// end of stream inside of a character
+		if( memory_traits::distance(pos_, end_ - 1) <= cut )
+			return error::illegal_chars;
+	}
+}
+
+// extends validated characters up to e, which should be a character start in the current data block
+inline bool source::valid_to(const char* e) noexcept
+{
+	if( valid_ < e )
+		valid_ = simd::utf8_validate(valid_, e);
+	return valid_ >= e;
+}
+
 
 // normalize line endings according W3C XML spec
 inline char source::normalize_line_endings(const char ch)
 {
-	switch( ch ) {
-	case CR:
-		// according xml standard \r\n combination should be interpret as single \n
-		if( io_likely( NL == *pos_ ) ) {
-			++pos_;
-			++row_;
-			col_ = 1;
-			return NL;
-		}
-		++col_;
-		break;
-	case NL:
-		++row_;
-		col_ = 1;
-		break;
-	default:
-		++col_;
+	// according xml standard \r\n combination should be interpret as single \n,
+	// the pair can be cut by the end of data block
+	if( io_unlikely( CR == ch && fetch() && NL == *pos_ ) ) {
+		++pos_;
+		return NL;
 	}
 	return ch;
 }
 
+// makes sure character at the current position is validated, and there is no error
 inline bool source::fetch() noexcept
 {
-	if( end_ == (pos_+1) )
-		last_ = charge();
-	return pos_ != end_ || error::ok == last_;
+	if( io_unlikely(pos_ == valid_) && error::ok == last_ )
+		last_ = validate();
+	// don't read after the end of data
+	return pos_ < valid_ && error::ok == last_;
 }
 
 char source::next() noexcept
@@ -199,50 +769,110 @@ char source::next() noexcept
 	constexpr const char EOF_CH = std::char_traits<char>::to_char_type( std::char_traits<char>::eof() );
 	if( io_unlikely( !fetch() ) )
 		return EOF_CH;
-	char ret;
-	// check for a multi-byte tail byte
-	if( io_unlikely(0 != mb_state_) ) {
-		ret = *pos_++;
-		--mb_state_;
+	// characters are validated, multi-byte characters bytes are returned one by one
+	const char ret = *pos_++;
+	return io_unlikely(CR == ret) ? normalize_line_endings(ret) : ret;
+}
+
+// counts lines and columns of the consumed characters [base_,e) lazily, when position is requested
+// or current data block is about to be replaced. Line is ended by \n, since \r\n pair is a single line end
+void source::count_position(const char* e) const noexcept
+{
+	if( nullptr == base_ || e <= base_ )
+		return;
+	const std::size_t lines = simd::count(base_, e, NL);
+	if( 0 == lines ) {
+		col_ += simd::utf8_length(base_, e);
 	} else {
-		unsigned int len = utf8::mblen( pos_ );
-		ret = *pos_++;
-		switch( len ) {
-		case io_likely(1):
-			ret = normalize_line_endings( ret );
-			break;
-		case 2: case 3: case 4:
-			mb_state_ = static_cast<uint8_t>(len - 1);
-			++col_;
-			break;
-		default:
-			last_ = error::illegal_chars;
-			ret = EOF_CH;
-			break;
-		}
+		const char* ln = e - 1;
+		while( NL != *ln )
+			--ln;
+		row_ += lines;
+		col_ = 1 + simd::utf8_length(ln + 1, e);
 	}
-	return ret;
+	offset_ += memory_traits::distance(base_, e);
+	base_ = e;
+}
+
+// consumed characters end, end of stream position is after the last data byte
+inline const char* source::consumed() const noexcept
+{
+	return pos_ < end_ ? pos_ : end_ - 1;
+}
+
+std::size_t source::row() const noexcept
+{
+	count_position( consumed() );
+	return row_;
+}
+
+std::size_t source::col() const noexcept
+{
+	count_position( consumed() );
+	return col_;
+}
+
+std::size_t source::position() const noexcept
+{
+	count_position( consumed() );
+	return offset_;
+}
+
+// grows token buffer to fit required bytes, up to the memory limit
+bool source::grow(byte_buffer& to, std::size_t required) noexcept
+{
+	std::size_t new_capacity = to.capacity() << 1;
+	if( new_capacity < required )
+		new_capacity = required;
+	if( new_capacity > limits_.memory )
+		new_capacity = limits_.memory;
+	if( io_unlikely( new_capacity < required || new_capacity <= to.capacity() || !to.extend( new_capacity - to.capacity() ) ) ) {
+		last_ = error::out_of_memory;
+		return false;
+	}
+	return true;
+}
+
+// appends validated characters run [pos_,stop) into the buffer
+inline bool source::put_run(byte_buffer& to, const char* stop) noexcept
+{
+	const std::size_t size = memory_traits::distance(pos_, stop);
+	if( 0 == size )
+		return true;
+	if( to.available() <= size && io_unlikely( !grow(to, to.capacity() + (size - to.available()) + 1) ) )
+		return false;
+	to.put( pos_, size );
+	pos_ = stop;
+	return true;
 }
 
 void source::read_until_char(byte_buffer& to,const char lookup,const char illegal) noexcept
 {
-	char c;
+	char c = 0;
 	char stops[3] = {lookup, illegal, EOF};
-	do {
+	for(;;) {
+		// copy validated characters before the first stop or carriage return, which requires normalization
+		if( io_likely( fetch() ) ) {
+			const char* stop = simd::find_first_of(pos_, valid_, lookup, illegal, CR);
+			if( io_unlikely( !put_run(to, stop) ) )
+				break;
+			// end of validated characters, validate next
+			if( pos_ == valid_ )
+				continue;
+		}
 		c = next();
 		if( !to.put(c) ) {
-			if( io_likely( to.exp_grow() ) ) {
+			if( io_likely( grow(to, to.capacity() + 1) ) )
 				to.put(c);
-			}
-			else {
-				last_ = error::out_of_memory;
+			else
 				break;
-			}
 		}
+		if( nullptr != io_memchr(stops, static_cast<int>(c), 3) )
+			break;
 	}
-	while( nullptr == io_memchr(stops, static_cast<int>(c), 3) );
-	if( lookup != c ) {
-		if(EOF == c)
+	if( lookup != c || error::out_of_memory == last_ ) {
+		// end of stream, unless the source failed with another error
+		if(EOF == c && error::ok == last_)
 			last_ = error::illegal_markup;
 		to.clear();
 	}
@@ -251,28 +881,131 @@ void source::read_until_char(byte_buffer& to,const char lookup,const char illega
 void source::read_until_double_char(byte_buffer& to, const char ch) noexcept
 {
 	const uint16_t pattern = pack_word(static_cast<uint16_t>(ch), ch);
-	char c;
+	char c = 0;
 	uint16_t i = 0;
-	do {
+	for(;;) {
+		// copy validated characters before the first separator or carriage return
+		if( io_likely( fetch() ) ) {
+			const char* stop = simd::find_first_of(pos_, valid_, ch, CR, CR);
+			const char* start = pos_;
+			if( io_unlikely( !put_run(to, stop) ) )
+				break;
+			// last character is not a separator
+			if( start != pos_ )
+				i = 0;
+			if( pos_ == valid_ )
+				continue;
+		}
 		c = next();
-		if( io_unlikely( cheq(c,EOF) ) )
+		// end of stream character can not be distinguished by value
+		if( io_unlikely( eof() ) )
 			break;
 		if( !to.put(c) ) {
-			if( io_likely( to.exp_grow() ) ) {
+			if( io_likely( grow(to, to.capacity() + 1) ) )
 				to.put(c);
-			}
-			else {
-				last_ = error::out_of_memory;
+			else
 				break;
-			}
 		}
 		i = pack_word(i,c);
+		if( i == pattern )
+			break;
 	}
-	while( i != pattern);
-	if( error::ok != last_ || cheq(c,EOF) )
+	if( error::ok != last_ || eof() )
 		to.clear();
 }
 
+char source::skip_until(const char c1, const char c2, const char c3, const char c4) noexcept
+{
+	constexpr const char EOF_CH = std::char_traits<char>::to_char_type( std::char_traits<char>::eof() );
+	for(;;) {
+		if( io_likely( fetch() ) ) {
+			pos_ = simd::find_first_of(pos_, valid_, c1, c2, c3, c4);
+			// end of validated characters, validate next
+			if( pos_ == valid_ )
+				continue;
+		}
+		const char c = next();
+		if( c1 == c || c2 == c || c3 == c || c4 == c || EOF_CH == c )
+			return c;
+	}
+}
+
+char source::skip_spaces() noexcept
+{
+	for(;;) {
+		if( !fetch() )
+			return peek();
+		pos_ = simd::skip_spaces(pos_, valid_);
+		// end of validated characters, validate next
+		if( pos_ != valid_ )
+			return *pos_;
+	}
+}
+
+char source::peek() noexcept
+{
+	constexpr const char EOF_CH = std::char_traits<char>::to_char_type( std::char_traits<char>::eof() );
+	return fetch() ? *pos_ : EOF_CH;
+}
+
+char_view source::read_view_until_char(byte_buffer& to,const char lookup,const char illegal) noexcept
+{
+	if( to.empty() && fetch() ) {
+		for(;;) {
+			const char* stop = simd::find_first_of(pos_, end_ - 1, lookup, illegal, CR);
+			// stop character found in the current data block
+			if( (stop + 1) < end_ ) {
+				if( cheq(lookup, *stop) && valid_to(stop + 1) ) {
+					const char* b = pos_;
+					pos_ = stop + 1;
+					return char_view(b, stop);
+				}
+				break;
+			}
+			// characters are cut by the end of data block, slide read window over them
+			if( !slide() )
+				break;
+		}
+	}
+	read_until_char(to, lookup, illegal);
+	if( to.empty() )
+		return char_view();
+	to.flip();
+	// don't add stop character
+	return char_view( to.position().cdata(), to.length() - 1 );
+}
+
+char_view source::read_view_until_double_char(byte_buffer& to, const char ch) noexcept
+{
+	if( fetch() ) {
+		// next character after double characters must be in the current block as well,
+		// so that parser can check it without fetching next data block
+		for(;;) {
+			const char* data_end = end_ - 2;
+			const char* stop = simd::find_first_of(pos_, data_end, ch, CR, CR);
+			while( (stop + 1) < data_end && cheq(ch, *stop) && !cheq(ch, stop[1]) )
+				stop = simd::find_first_of(stop + 1, data_end, ch, CR, CR);
+			if( (stop + 1) < data_end ) {
+				if( cheq(ch, *stop) && valid_to(stop + 2) ) {
+					const char* b = pos_;
+					pos_ = stop + 2;
+					return char_view(b, stop);
+				}
+				break;
+			}
+			// characters are cut by the end of data block, slide read window over them
+			if( !slide() )
+				break;
+		}
+	}
+	read_until_double_char(to, ch);
+	if( to.empty() )
+		return char_view();
+	to.flip();
+	// don't add double characters
+	return char_view( to.position().cdata(), to.length() - 2 );
+}
+
 } // namespace xml
 
 } // namesapce io